@@ -0,0 +1,107 @@
+/*
+      This file is part of steganogif
+      Copyright (C) 2020  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU General Public License as published by
+      the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+      GNU General Public License for more details.
+
+      You should have received a copy of the GNU General Public License
+      along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef STEGANOGIF_BOUNDED_QUEUE_H
+#define STEGANOGIF_BOUNDED_QUEUE_H
+
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+namespace steganogif
+{
+    /**
+     * Thread safe FIFO holding at most a fixed number of items. Producers
+     * wait while it is full and consumers wait while it is empty
+     */
+    template <typename T>
+    class bounded_queue
+    {
+      public:
+        /**
+         * Constructor
+         * @param p_capacity maximum number of items
+         */
+        inline explicit
+        bounded_queue(unsigned int p_capacity);
+
+        bounded_queue(const bounded_queue &) = delete;
+
+        bounded_queue & operator=(const bounded_queue &) = delete;
+
+        /**
+         * Add an item, waiting for room if queue is full
+         * @param p_item item to add
+         */
+        inline
+        void push(T p_item);
+
+        /**
+         * Remove oldest item, waiting for one if queue is empty
+         * @return removed item
+         */
+        inline
+        T pop();
+
+      private:
+        unsigned int m_capacity;
+        std::deque<T> m_items;
+        std::mutex m_mutex;
+        std::condition_variable m_not_full_condition;
+        std::condition_variable m_not_empty_condition;
+    };
+
+    //-------------------------------------------------------------------------
+    template <typename T>
+    bounded_queue<T>::bounded_queue(unsigned int p_capacity)
+    : m_capacity(p_capacity)
+    {
+    }
+
+    //-------------------------------------------------------------------------
+    template <typename T>
+    void
+    bounded_queue<T>::push(T p_item)
+    {
+        {
+            std::unique_lock<std::mutex> l_lock(m_mutex);
+            m_not_full_condition.wait(l_lock, [this]{return m_items.size() < m_capacity;});
+            m_items.emplace_back(std::move(p_item));
+        }
+        m_not_empty_condition.notify_one();
+    }
+
+    //-------------------------------------------------------------------------
+    template <typename T>
+    T
+    bounded_queue<T>::pop()
+    {
+        T l_item;
+        {
+            std::unique_lock<std::mutex> l_lock(m_mutex);
+            m_not_empty_condition.wait(l_lock, [this]{return !m_items.empty();});
+            l_item = std::move(m_items.front());
+            m_items.pop_front();
+        }
+        m_not_full_condition.notify_one();
+        return l_item;
+    }
+
+}
+#endif //STEGANOGIF_BOUNDED_QUEUE_H
+// EOF
@@ -0,0 +1,393 @@
+/*
+      This file is part of steganogif
+      Copyright (C) 2020  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU General Public License as published by
+      the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+      GNU General Public License for more details.
+
+      You should have received a copy of the GNU General Public License
+      along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef STEGANOGIF_COLOR_STATISTICS_H
+#define STEGANOGIF_COLOR_STATISTICS_H
+
+#include "yuv_kernels.h"
+#include "worker_pool.h"
+#include "my_bmp.h"
+#include <array>
+#include <vector>
+#include <set>
+#include <map>
+#include <bitset>
+#include <atomic>
+#include <algorithm>
+#include <cinttypes>
+
+namespace steganogif
+{
+    /**
+     * Histograms of RGB and YUV components of a picture along with the set
+     * of its distinct colors. Picture rows are split in bands whose
+     * histograms are fixed size arrays collected in parallel then summed,
+     * distinct colors being recorded by all bands in a shared bit set
+     */
+    class color_statistics
+    {
+      public:
+        /**
+         * Collect statistics of picture
+         * @param p_bmp picture
+         */
+        inline explicit
+        color_statistics(const lib_bmp::my_bmp & p_bmp);
+
+        /**
+         * Statistics of an empty picture
+         */
+        inline
+        color_statistics();
+
+        /**
+         * Number of bins of YUV component histograms. Bin of a component
+         * is its value computed by yuv_kernels::to_yuv_fixed plus
+         * m_yuv_offset
+         */
+        static constexpr unsigned int m_nb_yuv_bins = 512;
+
+        static constexpr int m_yuv_offset = 256;
+
+        inline
+        const std::array<uint32_t, 256> & get_red_histogram() const;
+
+        inline
+        const std::array<uint32_t, 256> & get_green_histogram() const;
+
+        inline
+        const std::array<uint32_t, 256> & get_blue_histogram() const;
+
+        inline
+        const std::array<uint32_t, m_nb_yuv_bins> & get_y_histogram() const;
+
+        inline
+        const std::array<uint32_t, m_nb_yuv_bins> & get_u_histogram() const;
+
+        inline
+        const std::array<uint32_t, m_nb_yuv_bins> & get_v_histogram() const;
+
+        /**
+         * Number of distinct colors of picture
+         */
+        inline
+        uint32_t get_nb_colors() const;
+
+        /**
+         * Number of distinct YUV colors of picture, as computed by
+         * yuv_kernels::to_yuv_fixed
+         */
+        inline
+        uint32_t get_nb_yuv_colors() const;
+
+        /**
+         * Distinct colors of picture
+         */
+        inline
+        std::set<lib_bmp::my_color> get_colors() const;
+
+        /**
+         * Convert histogram to values present in picture along with their
+         * number of occurrences
+         * @param p_histogram histogram
+         * @param p_offset offset between bin index and value
+         * @return number of occurrences by value
+         */
+        template <typename T, size_t NB_BINS>
+        inline static
+        std::map<T, unsigned int> to_map( const std::array<uint32_t, NB_BINS> & p_histogram
+                                        , int p_offset = 0
+                                        );
+
+      private:
+
+        /**
+         * Component histograms of a band of rows
+         */
+        struct histograms
+        {
+            /**
+             * Add histograms of another band
+             * @param p_histograms histograms to add
+             */
+            inline
+            void merge(const histograms & p_histograms);
+
+            std::array<uint32_t, 256> m_red{};
+            std::array<uint32_t, 256> m_green{};
+            std::array<uint32_t, 256> m_blue{};
+            std::array<uint32_t, m_nb_yuv_bins> m_y{};
+            std::array<uint32_t, m_nb_yuv_bins> m_u{};
+            std::array<uint32_t, m_nb_yuv_bins> m_v{};
+        };
+
+        /**
+         * Collect statistics of a band of rows, distinct colors being
+         * directly recorded in shared bit set
+         * @param p_bmp picture
+         * @param p_begin first row of band
+         * @param p_end row following last one of band
+         * @param p_histograms receive component histograms of band
+         */
+        inline
+        void add_rows( const lib_bmp::my_bmp & p_bmp
+                     , unsigned int p_begin
+                     , unsigned int p_end
+                     , histograms & p_histograms
+                     );
+
+        histograms m_histograms;
+
+        /**
+         * Bit set indexed by packed 24 bits color
+         * red << 16 | green << 8 | blue
+         * Bits are only set by bands so atomic words allow to share it
+         * instead of allocating and merging one bit set per band. A word is
+         * only written when bit is not already set, so that cache lines of
+         * frequent colors are not contended
+         */
+        std::vector<std::atomic<uint64_t>> m_colors;
+    };
+
+    //-------------------------------------------------------------------------
+    color_statistics::color_statistics()
+    : m_colors((1u << 24) / 64)
+    {
+        for(auto & l_word: m_colors)
+        {
+            l_word.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    color_statistics::color_statistics(const lib_bmp::my_bmp & p_bmp)
+    : color_statistics()
+    {
+        // One band per worker, each of them filling its own histograms
+        worker_pool l_worker_pool;
+        unsigned int l_height = p_bmp.get_height();
+        unsigned int l_nb_bands = std::max(1u, std::min(l_worker_pool.get_nb_workers(), l_height));
+        std::vector<histograms> l_band_histograms(l_nb_bands);
+        for(unsigned int l_band = 0; l_band < l_nb_bands; ++l_band)
+        {
+            histograms & l_histograms = l_band_histograms[l_band];
+            unsigned int l_begin = (uint64_t)l_height * l_band / l_nb_bands;
+            unsigned int l_end = (uint64_t)l_height * (l_band + 1) / l_nb_bands;
+            l_worker_pool.submit([&, l_begin, l_end]{add_rows(p_bmp, l_begin, l_end, l_histograms);});
+        }
+        l_worker_pool.wait();
+        for(const auto & l_histograms: l_band_histograms)
+        {
+            m_histograms.merge(l_histograms);
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    color_statistics::add_rows( const lib_bmp::my_bmp & p_bmp
+                              , unsigned int p_begin
+                              , unsigned int p_end
+                              , histograms & p_histograms
+                              )
+    {
+        // Rows are converted to YUV in one go from component buffers
+        unsigned int l_width = p_bmp.get_width();
+        std::vector<uint8_t> l_reds(l_width);
+        std::vector<uint8_t> l_greens(l_width);
+        std::vector<uint8_t> l_blues(l_width);
+        std::vector<int16_t> l_ys(l_width);
+        std::vector<int16_t> l_us(l_width);
+        std::vector<int16_t> l_vs(l_width);
+        for(unsigned int l_y = p_begin; l_y < p_end; ++l_y)
+        {
+            for(unsigned int l_x = 0; l_x < l_width; ++l_x)
+            {
+                lib_bmp::my_color l_color = p_bmp.get_pixel_color(l_x, l_y);
+                l_reds[l_x] = l_color.get_red();
+                l_greens[l_x] = l_color.get_green();
+                l_blues[l_x] = l_color.get_blue();
+                ++p_histograms.m_red[l_color.get_red()];
+                ++p_histograms.m_green[l_color.get_green()];
+                ++p_histograms.m_blue[l_color.get_blue()];
+                uint32_t l_packed = ((uint32_t)l_color.get_red() << 16) | ((uint32_t)l_color.get_green() << 8) | l_color.get_blue();
+                uint64_t l_bit = (uint64_t)1 << (l_packed % 64);
+                std::atomic<uint64_t> & l_word = m_colors[l_packed / 64];
+                if(!(l_word.load(std::memory_order_relaxed) & l_bit))
+                {
+                    l_word.fetch_or(l_bit, std::memory_order_relaxed);
+                }
+            }
+            yuv_kernels::to_yuv_fixed(l_reds.data(), l_greens.data(), l_blues.data(), l_ys.data(), l_us.data(), l_vs.data(), l_width);
+            for(unsigned int l_x = 0; l_x < l_width; ++l_x)
+            {
+                ++p_histograms.m_y[l_ys[l_x] + m_yuv_offset];
+                ++p_histograms.m_u[l_us[l_x] + m_yuv_offset];
+                ++p_histograms.m_v[l_vs[l_x] + m_yuv_offset];
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    color_statistics::histograms::merge(const histograms & p_histograms)
+    {
+        auto l_add = [](auto & p_histogram, const auto & p_other)
+        {
+            for(unsigned int l_index = 0; l_index < p_histogram.size(); ++l_index)
+            {
+                p_histogram[l_index] += p_other[l_index];
+            }
+        };
+        l_add(m_red, p_histograms.m_red);
+        l_add(m_green, p_histograms.m_green);
+        l_add(m_blue, p_histograms.m_blue);
+        l_add(m_y, p_histograms.m_y);
+        l_add(m_u, p_histograms.m_u);
+        l_add(m_v, p_histograms.m_v);
+    }
+
+    //-------------------------------------------------------------------------
+    const std::array<uint32_t, 256> &
+    color_statistics::get_red_histogram() const
+    {
+        return m_histograms.m_red;
+    }
+
+    //-------------------------------------------------------------------------
+    const std::array<uint32_t, 256> &
+    color_statistics::get_green_histogram() const
+    {
+        return m_histograms.m_green;
+    }
+
+    //-------------------------------------------------------------------------
+    const std::array<uint32_t, 256> &
+    color_statistics::get_blue_histogram() const
+    {
+        return m_histograms.m_blue;
+    }
+
+    //-------------------------------------------------------------------------
+    const std::array<uint32_t, color_statistics::m_nb_yuv_bins> &
+    color_statistics::get_y_histogram() const
+    {
+        return m_histograms.m_y;
+    }
+
+    //-------------------------------------------------------------------------
+    const std::array<uint32_t, color_statistics::m_nb_yuv_bins> &
+    color_statistics::get_u_histogram() const
+    {
+        return m_histograms.m_u;
+    }
+
+    //-------------------------------------------------------------------------
+    const std::array<uint32_t, color_statistics::m_nb_yuv_bins> &
+    color_statistics::get_v_histogram() const
+    {
+        return m_histograms.m_v;
+    }
+
+    //-------------------------------------------------------------------------
+    uint32_t
+    color_statistics::get_nb_colors() const
+    {
+        uint32_t l_nb_colors = 0;
+        for(const auto & l_word: m_colors)
+        {
+            l_nb_colors += std::bitset<64>(l_word.load(std::memory_order_relaxed)).count();
+        }
+        return l_nb_colors;
+    }
+
+    //-------------------------------------------------------------------------
+    uint32_t
+    color_statistics::get_nb_yuv_colors() const
+    {
+        // Conversion to integer YUV components is not injective so distinct
+        // colors are converted then distinct packed YUV colors counted
+        std::set<lib_bmp::my_color> l_colors = get_colors();
+        std::vector<uint8_t> l_reds;
+        std::vector<uint8_t> l_greens;
+        std::vector<uint8_t> l_blues;
+        l_reds.reserve(l_colors.size());
+        l_greens.reserve(l_colors.size());
+        l_blues.reserve(l_colors.size());
+        for(const auto & l_color: l_colors)
+        {
+            l_reds.push_back(l_color.get_red());
+            l_greens.push_back(l_color.get_green());
+            l_blues.push_back(l_color.get_blue());
+        }
+        std::vector<int16_t> l_ys(l_colors.size());
+        std::vector<int16_t> l_us(l_colors.size());
+        std::vector<int16_t> l_vs(l_colors.size());
+        yuv_kernels::to_yuv_fixed(l_reds.data(), l_greens.data(), l_blues.data(), l_ys.data(), l_us.data(), l_vs.data(), l_colors.size());
+        std::vector<uint32_t> l_packed_yuvs(l_colors.size());
+        for(unsigned int l_index = 0; l_index < l_colors.size(); ++l_index)
+        {
+            l_packed_yuvs[l_index] = ((uint32_t)(l_ys[l_index] + m_yuv_offset) << 18) | ((uint32_t)(l_us[l_index] + m_yuv_offset) << 9) | (uint32_t)(l_vs[l_index] + m_yuv_offset);
+        }
+        std::sort(l_packed_yuvs.begin(), l_packed_yuvs.end());
+        return std::unique(l_packed_yuvs.begin(), l_packed_yuvs.end()) - l_packed_yuvs.begin();
+    }
+
+    //-------------------------------------------------------------------------
+    std::set<lib_bmp::my_color>
+    color_statistics::get_colors() const
+    {
+        // Packed colors are visited in increasing order which is color
+        // order so each insertion happens at end of set
+        std::set<lib_bmp::my_color> l_colors;
+        for(uint32_t l_word_index = 0; l_word_index < m_colors.size(); ++l_word_index)
+        {
+            for(uint64_t l_word = m_colors[l_word_index].load(std::memory_order_relaxed); l_word; l_word &= l_word - 1)
+            {
+                unsigned int l_bit = 0;
+                while(!((l_word >> l_bit) & 1))
+                {
+                    ++l_bit;
+                }
+                uint32_t l_packed = l_word_index * 64 + l_bit;
+                l_colors.emplace_hint(l_colors.end(), (uint8_t)(l_packed >> 16), (uint8_t)(l_packed >> 8), (uint8_t)l_packed);
+            }
+        }
+        return l_colors;
+    }
+
+    //-------------------------------------------------------------------------
+    template <typename T, size_t NB_BINS>
+    std::map<T, unsigned int>
+    color_statistics::to_map( const std::array<uint32_t, NB_BINS> & p_histogram
+                            , int p_offset
+                            )
+    {
+        std::map<T, unsigned int> l_map;
+        for(unsigned int l_index = 0; l_index < NB_BINS; ++l_index)
+        {
+            if(p_histogram[l_index])
+            {
+                l_map.emplace_hint(l_map.end(), (T)((int)l_index - p_offset), p_histogram[l_index]);
+            }
+        }
+        return l_map;
+    }
+
+}
+#endif //STEGANOGIF_COLOR_STATISTICS_H
+// EOF
@@ -0,0 +1,193 @@
+/*
+      This file is part of steganogif
+      Copyright (C) 2020  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU General Public License as published by
+      the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+      GNU General Public License for more details.
+
+      You should have received a copy of the GNU General Public License
+      along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef STEGANOGIF_CONTENT_READER_H
+#define STEGANOGIF_CONTENT_READER_H
+
+#include "incremental_sha1.h"
+#include "quicky_exception.h"
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cinttypes>
+
+namespace steganogif
+{
+    /**
+     * Provide data to hide chunk by chunk. Data is made of encoded header
+     * followed by content file and SHA1 of content file. Content file is
+     * read and hashed on the fly so that only one chunk is kept in memory
+     */
+    class content_reader
+    {
+      public:
+        /**
+         * Constructor
+         * @param p_file_name name of content file
+         * @param p_content_size size of content file
+         * @param p_header encoded header
+         */
+        inline
+        content_reader( const std::string & p_file_name
+                      , uint64_t p_content_size
+                      , const std::vector<uint8_t> & p_header
+                      );
+
+        /**
+         * Total size of data: header + content + SHA1
+         * @return data size in bytes
+         */
+        inline
+        uint64_t get_size() const;
+
+        /**
+         * Read next chunk of data
+         * @param p_chunk receive data, its size is reduced when end of data is reached
+         * @param p_size requested number of bytes
+         */
+        inline
+        void read( std::vector<uint8_t> & p_chunk
+                 , size_t p_size
+                 );
+
+      private:
+
+        /**
+         * Copy part of a memory buffer that overlap current chunk
+         * @param p_buffer memory buffer
+         * @param p_buffer_size buffer size
+         * @param p_buffer_start buffer position in data
+         * @param p_chunk chunk being filled
+         * @param p_chunk_size current size of chunk
+         * @param p_size requested chunk size
+         */
+        inline
+        void copy_buffer( const uint8_t * p_buffer
+                        , uint64_t p_buffer_size
+                        , uint64_t p_buffer_start
+                        , std::vector<uint8_t> & p_chunk
+                        , size_t & p_chunk_size
+                        , size_t p_size
+                        );
+
+        std::ifstream m_file;
+        std::string m_file_name;
+        uint64_t m_content_size;
+        std::vector<uint8_t> m_header;
+        incremental_sha1 m_sha1;
+        std::vector<uint8_t> m_hash;
+
+        /**
+         * Position in data
+         */
+        uint64_t m_position;
+    };
+
+    //-------------------------------------------------------------------------
+    content_reader::content_reader( const std::string & p_file_name
+                                  , uint64_t p_content_size
+                                  , const std::vector<uint8_t> & p_header
+                                  )
+    : m_file_name(p_file_name)
+    , m_content_size(p_content_size)
+    , m_header(p_header)
+    , m_position(0)
+    {
+        m_file.open(p_file_name, std::ifstream::binary);
+        if(!m_file.is_open())
+        {
+            throw quicky_exception::quicky_runtime_exception( R"(Unable to find file ")" + p_file_name + R"(")", __LINE__, __FILE__);
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    uint64_t
+    content_reader::get_size() const
+    {
+        return m_header.size() + m_content_size + 5 * sizeof(uint32_t);
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    content_reader::read( std::vector<uint8_t> & p_chunk
+                        , size_t p_size
+                        )
+    {
+        p_chunk.resize(p_size);
+        size_t l_chunk_size = 0;
+
+        copy_buffer(m_header.data(), m_header.size(), 0, p_chunk, l_chunk_size, p_size);
+
+        // Content file part
+        uint64_t l_content_end = m_header.size() + m_content_size;
+        if(l_chunk_size < p_size && m_position < l_content_end)
+        {
+            size_t l_read_size = std::min((uint64_t)(p_size - l_chunk_size), l_content_end - m_position);
+            m_file.read((char*)p_chunk.data() + l_chunk_size, l_read_size);
+            if((size_t)m_file.gcount() != l_read_size)
+            {
+                throw quicky_exception::quicky_runtime_exception( R"(Unable to read content of file ")" + m_file_name + R"(")", __LINE__, __FILE__);
+            }
+            m_sha1.update(p_chunk.data() + l_chunk_size, l_read_size);
+            l_chunk_size += l_read_size;
+            m_position += l_read_size;
+            if(l_content_end == m_position)
+            {
+                m_file.close();
+            }
+        }
+
+        // SHA1 part
+        if(l_chunk_size < p_size && l_content_end == m_position)
+        {
+            m_sha1.finalize();
+            m_hash.resize(5 * sizeof(uint32_t));
+            for(unsigned int l_index = 0; l_index < 5; ++l_index)
+            {
+                uint32_t l_key = m_sha1.get_key(l_index);
+                std::memcpy(&m_hash[l_index * sizeof(uint32_t)], &l_key, sizeof(uint32_t));
+            }
+        }
+        copy_buffer(m_hash.data(), m_hash.size(), l_content_end, p_chunk, l_chunk_size, p_size);
+
+        p_chunk.resize(l_chunk_size);
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    content_reader::copy_buffer( const uint8_t * p_buffer
+                               , uint64_t p_buffer_size
+                               , uint64_t p_buffer_start
+                               , std::vector<uint8_t> & p_chunk
+                               , size_t & p_chunk_size
+                               , size_t p_size
+                               )
+    {
+        if(p_chunk_size < p_size && m_position >= p_buffer_start && m_position < p_buffer_start + p_buffer_size)
+        {
+            size_t l_copy_size = std::min((uint64_t)(p_size - p_chunk_size), p_buffer_start + p_buffer_size - m_position);
+            std::memcpy(p_chunk.data() + p_chunk_size, p_buffer + (m_position - p_buffer_start), l_copy_size);
+            p_chunk_size += l_copy_size;
+            m_position += l_copy_size;
+        }
+    }
+
+}
+#endif //STEGANOGIF_CONTENT_READER_H
+// EOF
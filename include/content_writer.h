@@ -0,0 +1,265 @@
+/*
+      This file is part of steganogif
+      Copyright (C) 2020  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU General Public License as published by
+      the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+      GNU General Public License for more details.
+
+      You should have received a copy of the GNU General Public License
+      along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef STEGANOGIF_CONTENT_WRITER_H
+#define STEGANOGIF_CONTENT_WRITER_H
+
+#include "incremental_sha1.h"
+#include "quicky_exception.h"
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cinttypes>
+
+namespace steganogif
+{
+    /**
+     * Receive extracted data chunk by chunk. Data is made of content file
+     * followed by its SHA1. Requested range of content is written to a
+     * temporary file and content is hashed on the fly, temporary file
+     * replacing content file only once SHA1 is checked
+     */
+    class content_writer
+    {
+      public:
+        /**
+         * Constructor
+         * @param p_file_name name of content file
+         */
+        inline explicit
+        content_writer(const std::string & p_file_name);
+
+        /**
+         * Remove temporary file if content was not committed
+         */
+        inline
+        ~content_writer();
+
+        content_writer(const content_writer &) = delete;
+
+        content_writer & operator=(const content_writer &) = delete;
+
+        /**
+         * Create temporary file once content size is known
+         * @param p_content_size size of content
+         * @param p_range_start offset of first content byte to write
+         * @param p_range_end offset following last content byte to write
+         * @param p_checked if true whole content followed by its SHA1 is
+         * expected, bytes outside of range being only hashed. Otherwise
+         * only range is expected and caller is in charge of checking it
+         */
+        inline
+        void open( uint64_t p_content_size
+                 , uint64_t p_range_start
+                 , uint64_t p_range_end
+                 , bool p_checked
+                 );
+
+        /**
+         * Provide next extracted bytes. Bytes preceding current position
+         * or following the expected ones are ignored
+         * @param p_position offset of first byte in content
+         * @param p_data extracted bytes
+         * @param p_size number of bytes
+         */
+        inline
+        void write( uint64_t p_position
+                  , const uint8_t * p_data
+                  , size_t p_size
+                  );
+
+        /**
+         * Check SHA1 then move temporary file to content file
+         * @return false if data is incomplete or SHA1 does not match, in
+         * which case temporary file is removed
+         */
+        inline
+        bool commit();
+
+      private:
+
+        /**
+         * Close and remove temporary file if it is still open
+         */
+        inline
+        void discard();
+
+        std::ofstream m_file;
+        std::string m_file_name;
+        std::string m_temporary_file_name;
+        uint64_t m_content_size;
+        uint64_t m_range_start;
+        uint64_t m_range_end;
+
+        /**
+         * Offset following last expected byte, SHA1 included when content
+         * is checked
+         */
+        uint64_t m_data_end;
+        bool m_checked;
+        incremental_sha1 m_sha1;
+        std::vector<uint8_t> m_hash;
+
+        /**
+         * Offset of next expected byte
+         */
+        uint64_t m_position;
+    };
+
+    //-------------------------------------------------------------------------
+    content_writer::content_writer(const std::string & p_file_name)
+    : m_file_name(p_file_name)
+    , m_temporary_file_name(p_file_name + ".part")
+    , m_content_size(0)
+    , m_range_start(0)
+    , m_range_end(0)
+    , m_data_end(0)
+    , m_checked(false)
+    , m_position(0)
+    {
+    }
+
+    //-------------------------------------------------------------------------
+    content_writer::~content_writer()
+    {
+        discard();
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    content_writer::open( uint64_t p_content_size
+                        , uint64_t p_range_start
+                        , uint64_t p_range_end
+                        , bool p_checked
+                        )
+    {
+        m_content_size = p_content_size;
+        m_range_start = p_range_start;
+        m_range_end = p_range_end;
+        m_checked = p_checked;
+        m_data_end = m_checked ? p_content_size + 5 * sizeof(uint32_t) : p_range_end;
+        m_position = m_checked ? 0 : p_range_start;
+        m_file.open(m_temporary_file_name, std::ofstream::binary);
+        if(!m_file.is_open())
+        {
+            throw quicky_exception::quicky_runtime_exception(R"(Unable to create file ")" + m_temporary_file_name + R"(")", __LINE__, __FILE__);
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    content_writer::write( uint64_t p_position
+                         , const uint8_t * p_data
+                         , size_t p_size
+                         )
+    {
+        if(p_position > m_position)
+        {
+            throw quicky_exception::quicky_logic_exception("Missing content bytes from offset " + std::to_string(m_position) + " to " + std::to_string(p_position), __LINE__, __FILE__);
+        }
+        uint64_t l_end = std::min(p_position + p_size, m_data_end);
+
+        // Content part, only range being written
+        if(m_position < l_end && m_position < m_content_size)
+        {
+            uint64_t l_content_end = std::min(l_end, m_content_size);
+            uint64_t l_write_start = std::max(m_position, m_range_start);
+            uint64_t l_write_end = std::min(l_content_end, m_range_end);
+            if(l_write_start < l_write_end)
+            {
+                m_file.write((const char*)p_data + (l_write_start - p_position), l_write_end - l_write_start);
+                if(!m_file)
+                {
+                    throw quicky_exception::quicky_runtime_exception(R"(Unable to write file ")" + m_temporary_file_name + R"(")", __LINE__, __FILE__);
+                }
+            }
+            if(m_checked)
+            {
+                m_sha1.update(p_data + (m_position - p_position), l_content_end - m_position);
+            }
+            m_position = l_content_end;
+        }
+
+        // SHA1 part
+        if(m_position < l_end)
+        {
+            const uint8_t * l_data = p_data + (m_position - p_position);
+            m_hash.insert(m_hash.end(), l_data, l_data + (l_end - m_position));
+            m_position = l_end;
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    bool
+    content_writer::commit()
+    {
+        if(!m_file.is_open() || m_position != m_data_end)
+        {
+            discard();
+            return false;
+        }
+        if(m_checked)
+        {
+            m_sha1.finalize();
+            for(unsigned int l_index = 0; l_index < 5; ++l_index)
+            {
+                uint32_t l_key;
+                std::memcpy(&l_key, &m_hash[l_index * sizeof(uint32_t)], sizeof(uint32_t));
+                if(m_sha1.get_key(l_index) != l_key)
+                {
+                    discard();
+                    return false;
+                }
+            }
+        }
+        m_file.close();
+        if(m_file.fail())
+        {
+            std::remove(m_temporary_file_name.c_str());
+            throw quicky_exception::quicky_runtime_exception(R"(Unable to write file ")" + m_temporary_file_name + R"(")", __LINE__, __FILE__);
+        }
+        // Renaming does not replace an existing file on every platform
+        if(std::rename(m_temporary_file_name.c_str(), m_file_name.c_str()))
+        {
+            std::remove(m_file_name.c_str());
+            if(std::rename(m_temporary_file_name.c_str(), m_file_name.c_str()))
+            {
+                std::remove(m_temporary_file_name.c_str());
+                throw quicky_exception::quicky_runtime_exception(R"(Unable to create file ")" + m_file_name + R"(")", __LINE__, __FILE__);
+            }
+        }
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    content_writer::discard()
+    {
+        if(m_file.is_open())
+        {
+            m_file.close();
+            std::remove(m_temporary_file_name.c_str());
+        }
+    }
+
+}
+#endif //STEGANOGIF_CONTENT_WRITER_H
+// EOF
@@ -0,0 +1,247 @@
+/*
+      This file is part of steganogif
+      Copyright (C) 2020  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU General Public License as published by
+      the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+      GNU General Public License for more details.
+
+      You should have received a copy of the GNU General Public License
+      along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef STEGANOGIF_FLAT_HISTOGRAM_H
+#define STEGANOGIF_FLAT_HISTOGRAM_H
+
+#include "countable_item.h"
+#include <vector>
+#include <set>
+#include <map>
+#include <algorithm>
+#include <cassert>
+#include <cinttypes>
+
+namespace steganogif
+{
+    /**
+     * Immutable histogram stored as items sorted by value along with
+     * prefix sums of their numbers of occurrences. Any range of items is
+     * then described by a pair of indexes whose statistics are computed
+     * without walking through items
+     */
+    template<typename T>
+    class flat_histogram
+    {
+      public:
+        inline explicit
+        flat_histogram(const std::map<T, unsigned int> & p_items);
+
+        inline explicit
+        flat_histogram(const std::set<countable_item<T>> & p_items);
+
+        inline
+        unsigned int get_nb_items() const;
+
+        inline
+        const countable_item<T> & get_item(unsigned int p_index) const;
+
+        /**
+         * Number of occurrences of items in range
+         * @param p_begin index of first item of range
+         * @param p_end index following last item of range
+         * @return number of occurrences
+         */
+        inline
+        uint64_t get_nb( unsigned int p_begin
+                       , unsigned int p_end
+                       ) const;
+
+        /**
+         * Sum of item values weighted by their number of occurrences
+         * @param p_begin index of first item of range
+         * @param p_end index following last item of range
+         * @return weighted sum
+         */
+        inline
+        int64_t get_weighted_sum( unsigned int p_begin
+                                , unsigned int p_end
+                                ) const;
+
+        /**
+         * Compute where to split a range of at least 2 items so that
+         * numbers of occurrences of both parts are as close as possible,
+         * tie being resolved in favour of first part. Partition is found
+         * by binary search on prefix sums
+         * @param p_begin index of first item of range
+         * @param p_end index following last item of range
+         * @return index of first item of second part
+         */
+        inline
+        unsigned int get_split_index( unsigned int p_begin
+                                    , unsigned int p_end
+                                    ) const;
+
+        /**
+         * Search for an item value in range
+         * @param p_begin index of first item of range
+         * @param p_end index following last item of range
+         * @param p_value value to search
+         * @return index of item having this value, p_end if there is none
+         */
+        inline
+        unsigned int find( unsigned int p_begin
+                         , unsigned int p_end
+                         , const T & p_value
+                         ) const;
+
+      private:
+
+        inline
+        void compute_prefix_sums();
+
+        std::vector<countable_item<T>> m_items;
+
+        /**
+         * Number of occurrences of items preceding each index, last one
+         * being the total
+         */
+        std::vector<uint64_t> m_prefix_nb;
+
+        /**
+         * Weighted sum of values of items preceding each index
+         */
+        std::vector<int64_t> m_prefix_weighted_sum;
+    };
+
+    //-------------------------------------------------------------------------
+    template<typename T>
+    flat_histogram<T>::flat_histogram(const std::map<T, unsigned int> & p_items)
+    {
+        m_items.reserve(p_items.size());
+        for(const auto & l_iter: p_items)
+        {
+            m_items.emplace_back(l_iter.first, l_iter.second);
+        }
+        compute_prefix_sums();
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename T>
+    flat_histogram<T>::flat_histogram(const std::set<countable_item<T>> & p_items)
+    : m_items(p_items.begin(), p_items.end())
+    {
+        compute_prefix_sums();
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename T>
+    void
+    flat_histogram<T>::compute_prefix_sums()
+    {
+        m_prefix_nb.resize(m_items.size() + 1);
+        m_prefix_weighted_sum.resize(m_items.size() + 1);
+        m_prefix_nb[0] = 0;
+        m_prefix_weighted_sum[0] = 0;
+        for(unsigned int l_index = 0; l_index < m_items.size(); ++l_index)
+        {
+            m_prefix_nb[l_index + 1] = m_prefix_nb[l_index] + m_items[l_index].get_nb();
+            m_prefix_weighted_sum[l_index + 1] = m_prefix_weighted_sum[l_index] + (int64_t)m_items[l_index].get_value() * m_items[l_index].get_nb();
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename T>
+    unsigned int
+    flat_histogram<T>::get_nb_items() const
+    {
+        return m_items.size();
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename T>
+    const countable_item<T> &
+    flat_histogram<T>::get_item(unsigned int p_index) const
+    {
+        assert(p_index < m_items.size());
+        return m_items[p_index];
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename T>
+    uint64_t
+    flat_histogram<T>::get_nb( unsigned int p_begin
+                             , unsigned int p_end
+                             ) const
+    {
+        return m_prefix_nb[p_end] - m_prefix_nb[p_begin];
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename T>
+    int64_t
+    flat_histogram<T>::get_weighted_sum( unsigned int p_begin
+                                       , unsigned int p_end
+                                       ) const
+    {
+        return m_prefix_weighted_sum[p_end] - m_prefix_weighted_sum[p_begin];
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename T>
+    unsigned int
+    flat_histogram<T>::get_split_index( unsigned int p_begin
+                                      , unsigned int p_end
+                                      ) const
+    {
+        assert(p_end - p_begin > 1);
+        // With P(i) number of occurrences preceding index i in range and
+        // N total of range, |2P(i) - N| decreases then increases. First
+        // part ends at first index where moving split point forward would
+        // increase imbalance, i.e. where P(i) + P(i + 1) > N. Condition
+        // is false for range first index and true for its last one
+        uint64_t l_threshold = m_prefix_nb[p_end] + m_prefix_nb[p_begin];
+        unsigned int l_low = p_begin + 1;
+        unsigned int l_high = p_end - 1;
+        while(l_low < l_high)
+        {
+            unsigned int l_middle = l_low + (l_high - l_low) / 2;
+            if(m_prefix_nb[l_middle] + m_prefix_nb[l_middle + 1] > l_threshold)
+            {
+                l_high = l_middle;
+            }
+            else
+            {
+                l_low = l_middle + 1;
+            }
+        }
+        return l_low;
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename T>
+    unsigned int
+    flat_histogram<T>::find( unsigned int p_begin
+                           , unsigned int p_end
+                           , const T & p_value
+                           ) const
+    {
+        auto l_iter = std::lower_bound( m_items.begin() + p_begin
+                                      , m_items.begin() + p_end
+                                      , p_value
+                                      , [](const countable_item<T> & p_item, const T & p_searched)
+                                        {
+                                            return p_item.get_value() < p_searched;
+                                        }
+                                      );
+        return (l_iter != m_items.begin() + p_end && l_iter->get_value() == p_value) ? l_iter - m_items.begin() : p_end;
+    }
+
+}
+#endif //STEGANOGIF_FLAT_HISTOGRAM_H
+// EOF
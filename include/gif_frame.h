@@ -0,0 +1,185 @@
+/*
+      This file is part of steganogif
+      Copyright (C) 2020  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU General Public License as published by
+      the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+      GNU General Public License for more details.
+
+      You should have received a copy of the GNU General Public License
+      along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef STEGANOGIF_GIF_FRAME_H
+#define STEGANOGIF_GIF_FRAME_H
+
+#include "my_color.h"
+#include <vector>
+#include <cassert>
+#include <cinttypes>
+
+namespace steganogif
+{
+    class gif_stream_reader;
+
+    /**
+     * Image of a GIF file with its graphic control information. Palette
+     * indexes are stored row by row in display order, interlacing being
+     * already removed
+     */
+    class gif_frame
+    {
+        friend class gif_stream_reader;
+
+      public:
+        inline
+        gif_frame();
+
+        inline
+        unsigned int get_left_position() const;
+
+        inline
+        unsigned int get_top_position() const;
+
+        inline
+        unsigned int get_width() const;
+
+        inline
+        unsigned int get_height() const;
+
+        inline
+        bool has_local_color_table() const;
+
+        inline
+        const std::vector<lib_bmp::my_color> & get_local_color_table() const;
+
+        inline
+        unsigned int get_disposal_method() const;
+
+        inline
+        bool has_transparent_color() const;
+
+        inline
+        uint8_t get_transparent_index() const;
+
+        inline
+        uint8_t get_index( unsigned int p_x
+                         , unsigned int p_y
+                         ) const;
+
+        inline
+        const std::vector<uint8_t> & get_indexes() const;
+
+      private:
+        unsigned int m_left_position;
+        unsigned int m_top_position;
+        unsigned int m_width;
+        unsigned int m_height;
+        std::vector<lib_bmp::my_color> m_local_color_table;
+        unsigned int m_disposal_method;
+        bool m_transparent_color;
+        uint8_t m_transparent_index;
+        std::vector<uint8_t> m_indexes;
+    };
+
+    //-------------------------------------------------------------------------
+    gif_frame::gif_frame()
+    : m_left_position(0)
+    , m_top_position(0)
+    , m_width(0)
+    , m_height(0)
+    , m_disposal_method(0)
+    , m_transparent_color(false)
+    , m_transparent_index(0)
+    {
+    }
+
+    //-------------------------------------------------------------------------
+    unsigned int
+    gif_frame::get_left_position() const
+    {
+        return m_left_position;
+    }
+
+    //-------------------------------------------------------------------------
+    unsigned int
+    gif_frame::get_top_position() const
+    {
+        return m_top_position;
+    }
+
+    //-------------------------------------------------------------------------
+    unsigned int
+    gif_frame::get_width() const
+    {
+        return m_width;
+    }
+
+    //-------------------------------------------------------------------------
+    unsigned int
+    gif_frame::get_height() const
+    {
+        return m_height;
+    }
+
+    //-------------------------------------------------------------------------
+    bool
+    gif_frame::has_local_color_table() const
+    {
+        return !m_local_color_table.empty();
+    }
+
+    //-------------------------------------------------------------------------
+    const std::vector<lib_bmp::my_color> &
+    gif_frame::get_local_color_table() const
+    {
+        return m_local_color_table;
+    }
+
+    //-------------------------------------------------------------------------
+    unsigned int
+    gif_frame::get_disposal_method() const
+    {
+        return m_disposal_method;
+    }
+
+    //-------------------------------------------------------------------------
+    bool
+    gif_frame::has_transparent_color() const
+    {
+        return m_transparent_color;
+    }
+
+    //-------------------------------------------------------------------------
+    uint8_t
+    gif_frame::get_transparent_index() const
+    {
+        return m_transparent_index;
+    }
+
+    //-------------------------------------------------------------------------
+    uint8_t
+    gif_frame::get_index( unsigned int p_x
+                        , unsigned int p_y
+                        ) const
+    {
+        assert(p_x < m_width && p_y < m_height);
+        return m_indexes[p_y * m_width + p_x];
+    }
+
+    //-------------------------------------------------------------------------
+    const std::vector<uint8_t> &
+    gif_frame::get_indexes() const
+    {
+        return m_indexes;
+    }
+
+}
+#endif //STEGANOGIF_GIF_FRAME_H
+// EOF
@@ -0,0 +1,706 @@
+/*
+      This file is part of steganogif
+      Copyright (C) 2020  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU General Public License as published by
+      the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+      GNU General Public License for more details.
+
+      You should have received a copy of the GNU General Public License
+      along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef STEGANOGIF_GIF_STREAM_READER_H
+#define STEGANOGIF_GIF_STREAM_READER_H
+
+#include "gif_frame.h"
+#include "my_color.h"
+#include "quicky_exception.h"
+#include <istream>
+#include <string>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cinttypes>
+
+namespace steganogif
+{
+    /**
+     * Read a GIF file block after block so that only one frame is kept in
+     * memory at a time. Bytes are read through a window which is either
+     * the whole file content when it is already in memory, typically
+     * mapped, or a buffer refilled from a stream. Image data are
+     * decompressed directly from this window
+     */
+    class gif_stream_reader
+    {
+      public:
+        /**
+         * Read GIF header, logical screen descriptor and global color table
+         * from a stream
+         * @param p_stream input stream
+         */
+        inline explicit
+        gif_stream_reader(std::istream & p_stream);
+
+        /**
+         * Read GIF header, logical screen descriptor and global color table
+         * from file content available in memory. Content must outlive reader
+         * @param p_data file content
+         * @param p_size file size
+         */
+        inline
+        gif_stream_reader( const uint8_t * p_data
+                         , size_t p_size
+                         );
+
+        gif_stream_reader(const gif_stream_reader &) = delete;
+
+        gif_stream_reader & operator=(const gif_stream_reader &) = delete;
+
+        inline
+        unsigned int get_width() const;
+
+        inline
+        unsigned int get_height() const;
+
+        inline
+        bool has_global_color_table() const;
+
+        inline
+        const std::vector<lib_bmp::my_color> & get_global_color_table() const;
+
+        inline
+        unsigned int get_background_index() const;
+
+        /**
+         * Read blocks up to next image, extensions other than graphic
+         * control one are skipped
+         * @param p_frame receive next image
+         * @return false if end of file was reached
+         */
+        inline
+        bool read_frame(gif_frame & p_frame);
+
+        /**
+         * Read blocks up to next image descriptor and local color table,
+         * image data being read by read_frame_indexes. Indexes of frame
+         * are not updated
+         * @param p_frame receive next image description
+         * @return false if end of file was reached
+         */
+        inline
+        bool read_frame_header(gif_frame & p_frame);
+
+        /**
+         * Decompress image data of frame whose header was just read
+         * @param p_destination receive palette indexes of first row
+         * @param p_stride distance between two rows in destination
+         */
+        inline
+        void read_frame_indexes( uint8_t * p_destination
+                               , size_t p_stride
+                               );
+
+        /**
+         * Scan remaining blocks without decompressing images to locate
+         * frames. Position is restored afterwards
+         * @param p_positions receive position of first block of each
+         * frame, to be used with seek_frame
+         * @param p_key_frames receive for each frame if it covers whole
+         * picture without transparency so that composing it does not
+         * depend on previous frames
+         */
+        inline
+        void index_frames( std::vector<uint64_t> & p_positions
+                         , std::vector<bool> & p_key_frames
+                         );
+
+        /**
+         * Move to a frame located by index_frames so that it is returned
+         * by next call to read_frame
+         * @param p_position position of first block of frame
+         */
+        inline
+        void seek_frame(uint64_t p_position);
+
+      private:
+
+        /**
+         * Read logical screen descriptor and global color table
+         */
+        inline
+        void read_header();
+
+        /**
+         * Replace window content by next stream bytes
+         * @return false if there are no more bytes
+         */
+        inline
+        bool refill();
+
+        /**
+         * Position of next byte in file
+         */
+        inline
+        uint64_t get_position() const;
+
+        inline
+        uint8_t read_byte();
+
+        inline
+        uint16_t read_word();
+
+        inline
+        void skip(size_t p_size);
+
+        /**
+         * Read a color table
+         * @param p_size number of colors
+         * @param p_color_table receive colors
+         */
+        inline
+        void read_color_table( unsigned int p_size
+                             , std::vector<lib_bmp::my_color> & p_color_table
+                             );
+
+        /**
+         * Skip data sub-blocks up to block terminator
+         */
+        inline
+        void skip_sub_blocks();
+
+        /**
+         * Stream providing bytes, nullptr when whole content is in window
+         */
+        std::istream * m_stream;
+        std::vector<uint8_t> m_buffer;
+
+        /**
+         * Window on file content, m_window_position being position in
+         * file of m_window_begin
+         */
+        const uint8_t * m_window_begin;
+        const uint8_t * m_current;
+        const uint8_t * m_window_end;
+        uint64_t m_window_position;
+
+        unsigned int m_width;
+        unsigned int m_height;
+        std::vector<lib_bmp::my_color> m_global_color_table;
+        unsigned int m_background_index;
+
+        /**
+         * Geometry of image whose data are not yet read
+         */
+        unsigned int m_frame_width;
+        unsigned int m_frame_height;
+        bool m_frame_interlaced;
+
+        static constexpr size_t m_buffer_size = 65536;
+        static constexpr unsigned int m_max_code = 4096;
+        std::array<uint16_t, m_max_code> m_prefixes;
+        std::array<uint8_t, m_max_code> m_suffixes;
+        std::array<uint8_t, m_max_code + 1> m_stack;
+    };
+
+    //-------------------------------------------------------------------------
+    gif_stream_reader::gif_stream_reader(std::istream & p_stream)
+    : m_stream(& p_stream)
+    , m_buffer(m_buffer_size)
+    , m_window_begin(m_buffer.data())
+    , m_current(m_buffer.data())
+    , m_window_end(m_buffer.data())
+    , m_window_position(p_stream.tellg())
+    , m_width(0)
+    , m_height(0)
+    , m_background_index(0)
+    , m_frame_width(0)
+    , m_frame_height(0)
+    , m_frame_interlaced(false)
+    , m_prefixes{}
+    , m_suffixes{}
+    , m_stack{}
+    {
+        read_header();
+    }
+
+    //-------------------------------------------------------------------------
+    gif_stream_reader::gif_stream_reader( const uint8_t * p_data
+                                        , size_t p_size
+                                        )
+    : m_stream(nullptr)
+    , m_window_begin(p_data)
+    , m_current(p_data)
+    , m_window_end(p_data + p_size)
+    , m_window_position(0)
+    , m_width(0)
+    , m_height(0)
+    , m_background_index(0)
+    , m_frame_width(0)
+    , m_frame_height(0)
+    , m_frame_interlaced(false)
+    , m_prefixes{}
+    , m_suffixes{}
+    , m_stack{}
+    {
+        read_header();
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    gif_stream_reader::read_header()
+    {
+        std::string l_signature;
+        for(unsigned int l_index = 0; l_index < 6; ++l_index)
+        {
+            l_signature += (char)read_byte();
+        }
+        if("GIF87a" != l_signature && "GIF89a" != l_signature)
+        {
+            throw quicky_exception::quicky_logic_exception("Bad GIF signature", __LINE__, __FILE__);
+        }
+        m_width = read_word();
+        m_height = read_word();
+        uint8_t l_packed = read_byte();
+        m_background_index = read_byte();
+        // Pixel aspect ratio
+        read_byte();
+        if(l_packed & 0x80)
+        {
+            read_color_table(2u << (l_packed & 0x7), m_global_color_table);
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    unsigned int
+    gif_stream_reader::get_width() const
+    {
+        return m_width;
+    }
+
+    //-------------------------------------------------------------------------
+    unsigned int
+    gif_stream_reader::get_height() const
+    {
+        return m_height;
+    }
+
+    //-------------------------------------------------------------------------
+    bool
+    gif_stream_reader::has_global_color_table() const
+    {
+        return !m_global_color_table.empty();
+    }
+
+    //-------------------------------------------------------------------------
+    const std::vector<lib_bmp::my_color> &
+    gif_stream_reader::get_global_color_table() const
+    {
+        return m_global_color_table;
+    }
+
+    //-------------------------------------------------------------------------
+    unsigned int
+    gif_stream_reader::get_background_index() const
+    {
+        return m_background_index;
+    }
+
+    //-------------------------------------------------------------------------
+    bool
+    gif_stream_reader::read_frame(gif_frame & p_frame)
+    {
+        if(!read_frame_header(p_frame))
+        {
+            return false;
+        }
+        p_frame.m_indexes.assign((size_t)p_frame.m_width * p_frame.m_height, 0);
+        read_frame_indexes(p_frame.m_indexes.data(), p_frame.m_width);
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    bool
+    gif_stream_reader::read_frame_header(gif_frame & p_frame)
+    {
+        p_frame.m_disposal_method = 0;
+        p_frame.m_transparent_color = false;
+        p_frame.m_transparent_index = 0;
+        for(;;)
+        {
+            uint8_t l_introducer = read_byte();
+            switch(l_introducer)
+            {
+                case 0x21:
+                {
+                    uint8_t l_label = read_byte();
+                    if(0xF9 == l_label)
+                    {
+                        // Graphic control extension
+                        uint8_t l_size = read_byte();
+                        if(4 != l_size)
+                        {
+                            throw quicky_exception::quicky_logic_exception("Bad graphic control extension size " + std::to_string(l_size), __LINE__, __FILE__);
+                        }
+                        uint8_t l_packed = read_byte();
+                        // Delay time
+                        read_word();
+                        p_frame.m_transparent_index = read_byte();
+                        p_frame.m_disposal_method = (l_packed >> 2) & 0x7;
+                        p_frame.m_transparent_color = l_packed & 0x1;
+                    }
+                    skip_sub_blocks();
+                    break;
+                }
+                case 0x2C:
+                {
+                    p_frame.m_left_position = read_word();
+                    p_frame.m_top_position = read_word();
+                    p_frame.m_width = read_word();
+                    p_frame.m_height = read_word();
+                    uint8_t l_packed = read_byte();
+                    p_frame.m_local_color_table.clear();
+                    if(l_packed & 0x80)
+                    {
+                        read_color_table(2u << (l_packed & 0x7), p_frame.m_local_color_table);
+                    }
+                    m_frame_width = p_frame.m_width;
+                    m_frame_height = p_frame.m_height;
+                    m_frame_interlaced = l_packed & 0x40;
+                    return true;
+                }
+                case 0x3B:
+                    return false;
+                default:
+                    throw quicky_exception::quicky_logic_exception("Unsupported GIF block introducer " + std::to_string(l_introducer), __LINE__, __FILE__);
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    gif_stream_reader::read_frame_indexes( uint8_t * p_destination
+                                         , size_t p_stride
+                                         )
+    {
+        unsigned int l_min_code_size = read_byte();
+        if(l_min_code_size < 2 || l_min_code_size > 8)
+        {
+            throw quicky_exception::quicky_logic_exception("Bad LZW minimum code size " + std::to_string(l_min_code_size), __LINE__, __FILE__);
+        }
+
+        // Data sub-blocks are consumed in place, l_block_remaining being
+        // number of bytes left in current one
+        unsigned int l_block_remaining = read_byte();
+        bool l_data_end = !l_block_remaining;
+
+        // Rows are stored by passes when interlaced: every 8th row from 0,
+        // every 8th row from 4, every 4th row from 2 and every 2nd row from 1
+        static constexpr std::array<unsigned int, 4> l_pass_starts{0, 4, 2, 1};
+        static constexpr std::array<unsigned int, 4> l_pass_steps{8, 8, 4, 2};
+        unsigned int l_pass = 0;
+        unsigned int l_row = 0;
+        unsigned int l_column = 0;
+        unsigned int l_nb_rows = m_frame_width ? m_frame_height : 0;
+        uint8_t * l_row_pointer = p_destination;
+
+        const unsigned int l_clear_code = 1u << l_min_code_size;
+        const unsigned int l_end_code = l_clear_code + 1;
+        for(unsigned int l_code = 0; l_code < l_clear_code; ++l_code)
+        {
+            m_prefixes[l_code] = 0;
+            m_suffixes[l_code] = l_code;
+        }
+        unsigned int l_code_size = l_min_code_size + 1;
+        unsigned int l_next_code = l_end_code + 1;
+        bool l_has_previous = false;
+        unsigned int l_previous_code = 0;
+        uint8_t l_first = 0;
+
+        uint32_t l_bit_buffer = 0;
+        unsigned int l_nb_bits = 0;
+        while(l_row < l_nb_rows)
+        {
+            while(l_nb_bits < l_code_size && !l_data_end)
+            {
+                l_bit_buffer |= ((uint32_t)read_byte()) << l_nb_bits;
+                l_nb_bits += 8;
+                if(!--l_block_remaining)
+                {
+                    l_block_remaining = read_byte();
+                    l_data_end = !l_block_remaining;
+                }
+            }
+            if(l_nb_bits < l_code_size)
+            {
+                // Truncated data, remaining pixels are left unchanged
+                break;
+            }
+            unsigned int l_code = l_bit_buffer & ((1u << l_code_size) - 1);
+            l_bit_buffer >>= l_code_size;
+            l_nb_bits -= l_code_size;
+
+            if(l_clear_code == l_code)
+            {
+                l_code_size = l_min_code_size + 1;
+                l_next_code = l_end_code + 1;
+                l_has_previous = false;
+                continue;
+            }
+            if(l_end_code == l_code)
+            {
+                break;
+            }
+
+            unsigned int l_in_code = l_code;
+            unsigned int l_stack_size = 0;
+            if(!l_has_previous)
+            {
+                if(l_code >= l_clear_code)
+                {
+                    throw quicky_exception::quicky_logic_exception("Bad first LZW code " + std::to_string(l_code), __LINE__, __FILE__);
+                }
+            }
+            else if(l_code == l_next_code)
+            {
+                m_stack[l_stack_size++] = l_first;
+                l_code = l_previous_code;
+            }
+            else if(l_code > l_next_code)
+            {
+                throw quicky_exception::quicky_logic_exception("Bad LZW code " + std::to_string(l_code), __LINE__, __FILE__);
+            }
+            while(l_code >= l_clear_code)
+            {
+                m_stack[l_stack_size++] = m_suffixes[l_code];
+                l_code = m_prefixes[l_code];
+            }
+            l_first = m_suffixes[l_code];
+            m_stack[l_stack_size++] = l_first;
+
+            if(l_has_previous && l_next_code < m_max_code)
+            {
+                m_prefixes[l_next_code] = l_previous_code;
+                m_suffixes[l_next_code] = l_first;
+                ++l_next_code;
+                if(l_next_code == (1u << l_code_size) && l_code_size < 12)
+                {
+                    ++l_code_size;
+                }
+            }
+            l_has_previous = true;
+            l_previous_code = l_in_code;
+
+            while(l_stack_size && l_row < l_nb_rows)
+            {
+                l_row_pointer[l_column++] = m_stack[--l_stack_size];
+                if(m_frame_width == l_column)
+                {
+                    l_column = 0;
+                    if(m_frame_interlaced)
+                    {
+                        l_row += l_pass_steps[l_pass];
+                        while(l_row >= m_frame_height && l_pass < 3)
+                        {
+                            ++l_pass;
+                            l_row = l_pass_starts[l_pass];
+                        }
+                        if(l_row >= m_frame_height)
+                        {
+                            l_row = l_nb_rows;
+                        }
+                    }
+                    else
+                    {
+                        ++l_row;
+                    }
+                    l_row_pointer = p_destination + l_row * p_stride;
+                }
+            }
+        }
+
+        // Skip what remains of data up to block terminator
+        if(!l_data_end)
+        {
+            skip(l_block_remaining);
+            skip_sub_blocks();
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    gif_stream_reader::index_frames( std::vector<uint64_t> & p_positions
+                                   , std::vector<bool> & p_key_frames
+                                   )
+    {
+        p_positions.clear();
+        p_key_frames.clear();
+        uint64_t l_initial_position = get_position();
+        uint64_t l_frame_position = l_initial_position;
+        bool l_transparent_color = false;
+        for(bool l_trailer = false; !l_trailer;)
+        {
+            uint8_t l_introducer = read_byte();
+            switch(l_introducer)
+            {
+                case 0x21:
+                {
+                    uint8_t l_label = read_byte();
+                    if(0xF9 == l_label)
+                    {
+                        // Graphic control extension, only transparency matters
+                        read_byte();
+                        l_transparent_color = read_byte() & 0x1;
+                        read_word();
+                        read_byte();
+                    }
+                    skip_sub_blocks();
+                    break;
+                }
+                case 0x2C:
+                {
+                    unsigned int l_left_position = read_word();
+                    unsigned int l_top_position = read_word();
+                    unsigned int l_width = read_word();
+                    unsigned int l_height = read_word();
+                    uint8_t l_packed = read_byte();
+                    if(l_packed & 0x80)
+                    {
+                        skip(3 * (2u << (l_packed & 0x7)));
+                    }
+                    // LZW minimum code size then compressed data
+                    read_byte();
+                    skip_sub_blocks();
+                    p_positions.emplace_back(l_frame_position);
+                    p_key_frames.push_back(!l_transparent_color && !l_left_position && !l_top_position && m_width == l_width && m_height == l_height);
+                    l_transparent_color = false;
+                    l_frame_position = get_position();
+                    break;
+                }
+                case 0x3B:
+                    l_trailer = true;
+                    break;
+                default:
+                    throw quicky_exception::quicky_logic_exception("Unsupported GIF block introducer " + std::to_string(l_introducer), __LINE__, __FILE__);
+            }
+        }
+        seek_frame(l_initial_position);
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    gif_stream_reader::seek_frame(uint64_t p_position)
+    {
+        if(p_position >= m_window_position && p_position <= m_window_position + (m_window_end - m_window_begin))
+        {
+            m_current = m_window_begin + (p_position - m_window_position);
+            return;
+        }
+        if(!m_stream)
+        {
+            throw quicky_exception::quicky_logic_exception("Position " + std::to_string(p_position) + " is outside of GIF file", __LINE__, __FILE__);
+        }
+        m_stream->clear();
+        m_stream->seekg(p_position);
+        if(!*m_stream)
+        {
+            throw quicky_exception::quicky_runtime_exception("Unable to seek in GIF file", __LINE__, __FILE__);
+        }
+        m_window_position = p_position;
+        m_window_begin = m_current = m_window_end = m_buffer.data();
+    }
+
+    //-------------------------------------------------------------------------
+    bool
+    gif_stream_reader::refill()
+    {
+        if(!m_stream)
+        {
+            return false;
+        }
+        m_window_position += m_window_end - m_window_begin;
+        m_stream->read((char*)m_buffer.data(), m_buffer.size());
+        m_window_begin = m_current = m_buffer.data();
+        m_window_end = m_buffer.data() + m_stream->gcount();
+        return m_window_end != m_window_begin;
+    }
+
+    //-------------------------------------------------------------------------
+    uint64_t
+    gif_stream_reader::get_position() const
+    {
+        return m_window_position + (m_current - m_window_begin);
+    }
+
+    //-------------------------------------------------------------------------
+    uint8_t
+    gif_stream_reader::read_byte()
+    {
+        if(m_window_end == m_current && !refill())
+        {
+            throw quicky_exception::quicky_runtime_exception("Unexpected end of GIF file", __LINE__, __FILE__);
+        }
+        return *m_current++;
+    }
+
+    //-------------------------------------------------------------------------
+    uint16_t
+    gif_stream_reader::read_word()
+    {
+        uint16_t l_word = read_byte();
+        l_word |= ((uint16_t)read_byte()) << 8;
+        return l_word;
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    gif_stream_reader::skip(size_t p_size)
+    {
+        while(p_size)
+        {
+            if(m_window_end == m_current && !refill())
+            {
+                throw quicky_exception::quicky_runtime_exception("Unexpected end of GIF file", __LINE__, __FILE__);
+            }
+            size_t l_size = std::min<size_t>(p_size, m_window_end - m_current);
+            m_current += l_size;
+            p_size -= l_size;
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    gif_stream_reader::read_color_table( unsigned int p_size
+                                       , std::vector<lib_bmp::my_color> & p_color_table
+                                       )
+    {
+        p_color_table.clear();
+        for(unsigned int l_index = 0; l_index < p_size; ++l_index)
+        {
+            uint8_t l_red = read_byte();
+            uint8_t l_green = read_byte();
+            uint8_t l_blue = read_byte();
+            p_color_table.emplace_back(l_red, l_green, l_blue);
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    gif_stream_reader::skip_sub_blocks()
+    {
+        for(uint8_t l_size = read_byte(); l_size; l_size = read_byte())
+        {
+            skip(l_size);
+        }
+    }
+
+}
+#endif //STEGANOGIF_GIF_STREAM_READER_H
+// EOF
@@ -0,0 +1,145 @@
+/*
+      This file is part of steganogif
+      Copyright (C) 2020  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU General Public License as published by
+      the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+      GNU General Public License for more details.
+
+      You should have received a copy of the GNU General Public License
+      along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef STEGANOGIF_GRID_QUANTIZER_H
+#define STEGANOGIF_GRID_QUANTIZER_H
+
+#include "indexed_picture.h"
+#include "my_bmp.h"
+#include <array>
+#include <vector>
+#include <cinttypes>
+
+namespace steganogif
+{
+    /**
+     * Reduce a picture to the fixed 128 colors palette made of 4 red levels,
+     * 8 green levels and 4 blue levels. Palette index is
+     * 32 * red level + 4 * green level + blue level.
+     * As palette is a grid, closest palette color is obtained by choosing
+     * closest level of each component independently, which is done with
+     * one lookup table per component computed at compilation time
+     */
+    class grid_quantizer
+    {
+      public:
+        /**
+         * Quantize picture
+         * @param p_bmp BMP content to quantize
+         * @return picture whose 128 first palette entries are the grid
+         * colors, remaining ones being black
+         */
+        inline static
+        indexed_picture quantize(const lib_bmp::my_bmp & p_bmp);
+
+        static constexpr unsigned int m_nb_colors = 128;
+
+      private:
+
+        /**
+         * Compute lookup table giving, for each component value, index of
+         * closest level shifted to its position in palette index. In case
+         * of tie the lower level is chosen
+         * @param p_levels component levels sorted by increasing values
+         * @param p_shift position of level index in palette index
+         * @return lookup table
+         */
+        template <size_t NB_LEVELS>
+        inline static constexpr
+        std::array<uint8_t, 256> compute_lut( const std::array<uint8_t, NB_LEVELS> & p_levels
+                                            , unsigned int p_shift
+                                            );
+
+        static constexpr std::array<uint8_t, 4> m_red_levels{0, 64, 128, 255};
+        static constexpr std::array<uint8_t, 8> m_green_levels{0, 32, 64, 96, 128, 160, 192, 255};
+        static constexpr std::array<uint8_t, 4> m_blue_levels{0, 64, 128, 255};
+    };
+
+    //-------------------------------------------------------------------------
+    template <size_t NB_LEVELS>
+    constexpr
+    std::array<uint8_t, 256>
+    grid_quantizer::compute_lut( const std::array<uint8_t, NB_LEVELS> & p_levels
+                               , unsigned int p_shift
+                               )
+    {
+        std::array<uint8_t, 256> l_lut{};
+        unsigned int l_level = 0;
+        for(int l_value = 0; l_value < 256; ++l_value)
+        {
+            // Move to next level while it is strictly closer
+            while(l_level + 1 < NB_LEVELS && p_levels[l_level + 1] - l_value < l_value - p_levels[l_level])
+            {
+                ++l_level;
+            }
+            l_lut[l_value] = l_level << p_shift;
+        }
+        return l_lut;
+    }
+
+    //-------------------------------------------------------------------------
+    indexed_picture
+    grid_quantizer::quantize(const lib_bmp::my_bmp & p_bmp)
+    {
+        static constexpr std::array<uint8_t, 256> l_red_lut = compute_lut(m_red_levels, 5);
+        static constexpr std::array<uint8_t, 256> l_green_lut = compute_lut(m_green_levels, 2);
+        static constexpr std::array<uint8_t, 256> l_blue_lut = compute_lut(m_blue_levels, 0);
+
+        indexed_picture l_picture{p_bmp.get_width(), p_bmp.get_height()};
+        unsigned int l_index = 0;
+        for(auto l_red: m_red_levels)
+        {
+            for(auto l_green: m_green_levels)
+            {
+                for(auto l_blue: m_blue_levels)
+                {
+                    l_picture.set_color(l_index, lib_bmp::my_color(l_red, l_green, l_blue));
+                    ++l_index;
+                }
+            }
+        }
+        assert(m_nb_colors == l_index);
+
+        // Components of a row are first collected then converted in a
+        // loop free of BMP accesses
+        unsigned int l_width = p_bmp.get_width();
+        std::vector<uint8_t> l_reds(l_width);
+        std::vector<uint8_t> l_greens(l_width);
+        std::vector<uint8_t> l_blues(l_width);
+        std::vector<uint8_t> & l_indexes = l_picture.get_indexes();
+        for(unsigned int l_y = 0; l_y < p_bmp.get_height(); ++l_y)
+        {
+            for(unsigned int l_x = 0; l_x < l_width; ++l_x)
+            {
+                lib_bmp::my_color l_color = p_bmp.get_pixel_color(l_x, l_y);
+                l_reds[l_x] = l_color.get_red();
+                l_greens[l_x] = l_color.get_green();
+                l_blues[l_x] = l_color.get_blue();
+            }
+            uint8_t * l_row = l_indexes.data() + l_y * l_width;
+            for(unsigned int l_x = 0; l_x < l_width; ++l_x)
+            {
+                l_row[l_x] = l_red_lut[l_reds[l_x]] | l_green_lut[l_greens[l_x]] | l_blue_lut[l_blues[l_x]];
+            }
+        }
+        return l_picture;
+    }
+
+}
+#endif //STEGANOGIF_GRID_QUANTIZER_H
+// EOF
@@ -0,0 +1,230 @@
+/*
+      This file is part of steganogif
+      Copyright (C) 2020  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU General Public License as published by
+      the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+      GNU General Public License for more details.
+
+      You should have received a copy of the GNU General Public License
+      along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef STEGANOGIF_INCREMENTAL_SHA1_H
+#define STEGANOGIF_INCREMENTAL_SHA1_H
+
+#include "quicky_exception.h"
+#include <array>
+#include <algorithm>
+#include <cassert>
+#include <cinttypes>
+#include <cstddef>
+
+namespace steganogif
+{
+    /**
+     * SHA1 computed on data provided chunk by chunk. Keys are the same
+     * than the ones provided by sha1 class on the whole data
+     */
+    class incremental_sha1
+    {
+      public:
+        inline
+        incremental_sha1();
+
+        /**
+         * Add data to hash
+         * @param p_data data to add
+         * @param p_size data size in bytes
+         */
+        inline
+        void update( const uint8_t * p_data
+                   , size_t p_size
+                   );
+
+        /**
+         * Complete hash computation, no more data can be added after
+         */
+        inline
+        void finalize();
+
+        /**
+         * Return a 32 bits part of the hash
+         * @param p_index part index in [0:4]
+         * @return hash part
+         */
+        inline
+        uint32_t get_key(unsigned int p_index) const;
+
+      private:
+
+        inline
+        void process_block(const uint8_t * p_block);
+
+        inline static
+        uint32_t rotate_left( uint32_t p_value
+                            , unsigned int p_shift
+                            );
+
+        std::array<uint32_t, 5> m_keys;
+        std::array<uint8_t, 64> m_block;
+        unsigned int m_block_size;
+        uint64_t m_total_size;
+        bool m_finalized;
+    };
+
+    //-------------------------------------------------------------------------
+    incremental_sha1::incremental_sha1()
+    : m_keys{0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0}
+    , m_block{}
+    , m_block_size(0)
+    , m_total_size(0)
+    , m_finalized(false)
+    {
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    incremental_sha1::update( const uint8_t * p_data
+                            , size_t p_size
+                            )
+    {
+        if(m_finalized)
+        {
+            throw quicky_exception::quicky_logic_exception("SHA1 already finalized", __LINE__, __FILE__);
+        }
+        m_total_size += p_size;
+        while(p_size)
+        {
+            if(!m_block_size && p_size >= m_block.size())
+            {
+                process_block(p_data);
+                p_data += m_block.size();
+                p_size -= m_block.size();
+                continue;
+            }
+            size_t l_copy_size = std::min(p_size, (size_t)(m_block.size() - m_block_size));
+            std::copy(p_data, p_data + l_copy_size, m_block.begin() + m_block_size);
+            m_block_size += l_copy_size;
+            p_data += l_copy_size;
+            p_size -= l_copy_size;
+            if(m_block.size() == m_block_size)
+            {
+                process_block(m_block.data());
+                m_block_size = 0;
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    incremental_sha1::finalize()
+    {
+        if(m_finalized)
+        {
+            return;
+        }
+        uint64_t l_bit_size = 8 * m_total_size;
+        uint8_t l_padding = 0x80;
+        update(&l_padding, 1);
+        l_padding = 0;
+        while(56 != m_block_size)
+        {
+            update(&l_padding, 1);
+        }
+        std::array<uint8_t, 8> l_size;
+        for(unsigned int l_index = 0; l_index < l_size.size(); ++l_index)
+        {
+            l_size[l_index] = (uint8_t)(l_bit_size >> (56 - 8 * l_index));
+        }
+        update(l_size.data(), l_size.size());
+        m_finalized = true;
+    }
+
+    //-------------------------------------------------------------------------
+    uint32_t
+    incremental_sha1::get_key(unsigned int p_index) const
+    {
+        assert(m_finalized);
+        assert(p_index < m_keys.size());
+        return m_keys[p_index];
+    }
+
+    //-------------------------------------------------------------------------
+    uint32_t
+    incremental_sha1::rotate_left( uint32_t p_value
+                                 , unsigned int p_shift
+                                 )
+    {
+        return (p_value << p_shift) | (p_value >> (32 - p_shift));
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    incremental_sha1::process_block(const uint8_t * p_block)
+    {
+        std::array<uint32_t, 80> l_words;
+        for(unsigned int l_index = 0; l_index < 16; ++l_index)
+        {
+            l_words[l_index] = ((uint32_t)p_block[4 * l_index] << 24) |
+                               ((uint32_t)p_block[4 * l_index + 1] << 16) |
+                               ((uint32_t)p_block[4 * l_index + 2] << 8) |
+                               ((uint32_t)p_block[4 * l_index + 3]);
+        }
+        for(unsigned int l_index = 16; l_index < 80; ++l_index)
+        {
+            l_words[l_index] = rotate_left(l_words[l_index - 3] ^ l_words[l_index - 8] ^ l_words[l_index - 14] ^ l_words[l_index - 16], 1);
+        }
+
+        uint32_t l_a = m_keys[0];
+        uint32_t l_b = m_keys[1];
+        uint32_t l_c = m_keys[2];
+        uint32_t l_d = m_keys[3];
+        uint32_t l_e = m_keys[4];
+        for(unsigned int l_index = 0; l_index < 80; ++l_index)
+        {
+            uint32_t l_f;
+            uint32_t l_k;
+            if(l_index < 20)
+            {
+                l_f = (l_b & l_c) | (~l_b & l_d);
+                l_k = 0x5A827999;
+            }
+            else if(l_index < 40)
+            {
+                l_f = l_b ^ l_c ^ l_d;
+                l_k = 0x6ED9EBA1;
+            }
+            else if(l_index < 60)
+            {
+                l_f = (l_b & l_c) | (l_b & l_d) | (l_c & l_d);
+                l_k = 0x8F1BBCDC;
+            }
+            else
+            {
+                l_f = l_b ^ l_c ^ l_d;
+                l_k = 0xCA62C1D6;
+            }
+            uint32_t l_temp = rotate_left(l_a, 5) + l_f + l_e + l_k + l_words[l_index];
+            l_e = l_d;
+            l_d = l_c;
+            l_c = rotate_left(l_b, 30);
+            l_b = l_a;
+            l_a = l_temp;
+        }
+        m_keys[0] += l_a;
+        m_keys[1] += l_b;
+        m_keys[2] += l_c;
+        m_keys[3] += l_d;
+        m_keys[4] += l_e;
+    }
+
+}
+#endif //STEGANOGIF_INCREMENTAL_SHA1_H
+// EOF
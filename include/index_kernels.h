@@ -0,0 +1,133 @@
+/*
+      This file is part of steganogif
+      Copyright (C) 2020  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU General Public License as published by
+      the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+      GNU General Public License for more details.
+
+      You should have received a copy of the GNU General Public License
+      along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef STEGANOGIF_INDEX_KERNELS_H
+#define STEGANOGIF_INDEX_KERNELS_H
+
+#include <cstddef>
+#include <cinttypes>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif // __AVX2__
+
+namespace steganogif
+{
+    /**
+     * Bulk operations on palette indexes of pictures whose palette store
+     * each pair of colors at indexes 2k and 2k+1, lower color first.
+     * Selecting the lower or upper color of a pair is then a matter of
+     * setting the least significant bit of index.
+     * AVX2 or SSE2 versions are used depending on compilation flags,
+     * scalar code handles remaining indexes
+     */
+    class index_kernels
+    {
+      public:
+        /**
+         * Replace each index by the one of its pair encoding bit
+         * @param p_indexes palette indexes
+         * @param p_bits bits to encode, one per byte with value 0 or 1
+         * @param p_size number of indexes
+         */
+        inline static
+        void embed( uint8_t * p_indexes
+                  , const uint8_t * p_bits
+                  , size_t p_size
+                  );
+
+        /**
+         * Retrieve bits encoded in indexes
+         * @param p_indexes palette indexes
+         * @param p_bits receive bits, one per byte with value 0 or 1
+         * @param p_size number of indexes
+         */
+        inline static
+        void extract( const uint8_t * p_indexes
+                    , uint8_t * p_bits
+                    , size_t p_size
+                    );
+    };
+
+    //-------------------------------------------------------------------------
+    void
+    index_kernels::embed( uint8_t * p_indexes
+                        , const uint8_t * p_bits
+                        , size_t p_size
+                        )
+    {
+        size_t l_index = 0;
+#if defined(__AVX2__)
+        const __m256i l_pair_mask = _mm256_set1_epi8((char)0xFE);
+        for(; l_index + 32 <= p_size; l_index += 32)
+        {
+            __m256i l_indexes = _mm256_loadu_si256((const __m256i*)(p_indexes + l_index));
+            __m256i l_bits = _mm256_loadu_si256((const __m256i*)(p_bits + l_index));
+            l_indexes = _mm256_or_si256(_mm256_and_si256(l_indexes, l_pair_mask), l_bits);
+            _mm256_storeu_si256((__m256i*)(p_indexes + l_index), l_indexes);
+        }
+#elif defined(__SSE2__)
+        const __m128i l_pair_mask = _mm_set1_epi8((char)0xFE);
+        for(; l_index + 16 <= p_size; l_index += 16)
+        {
+            __m128i l_indexes = _mm_loadu_si128((const __m128i*)(p_indexes + l_index));
+            __m128i l_bits = _mm_loadu_si128((const __m128i*)(p_bits + l_index));
+            l_indexes = _mm_or_si128(_mm_and_si128(l_indexes, l_pair_mask), l_bits);
+            _mm_storeu_si128((__m128i*)(p_indexes + l_index), l_indexes);
+        }
+#endif // __AVX2__
+        for(; l_index < p_size; ++l_index)
+        {
+            p_indexes[l_index] = (p_indexes[l_index] & 0xFE) | p_bits[l_index];
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    index_kernels::extract( const uint8_t * p_indexes
+                          , uint8_t * p_bits
+                          , size_t p_size
+                          )
+    {
+        size_t l_index = 0;
+#if defined(__AVX2__)
+        const __m256i l_bit_mask = _mm256_set1_epi8(1);
+        for(; l_index + 32 <= p_size; l_index += 32)
+        {
+            __m256i l_indexes = _mm256_loadu_si256((const __m256i*)(p_indexes + l_index));
+            _mm256_storeu_si256((__m256i*)(p_bits + l_index), _mm256_and_si256(l_indexes, l_bit_mask));
+        }
+#elif defined(__SSE2__)
+        const __m128i l_bit_mask = _mm_set1_epi8(1);
+        for(; l_index + 16 <= p_size; l_index += 16)
+        {
+            __m128i l_indexes = _mm_loadu_si128((const __m128i*)(p_indexes + l_index));
+            _mm_storeu_si128((__m128i*)(p_bits + l_index), _mm_and_si128(l_indexes, l_bit_mask));
+        }
+#endif // __AVX2__
+        for(; l_index < p_size; ++l_index)
+        {
+            p_bits[l_index] = p_indexes[l_index] & 1;
+        }
+    }
+
+}
+#endif //STEGANOGIF_INDEX_KERNELS_H
+// EOF
@@ -0,0 +1,328 @@
+/*
+      This file is part of steganogif
+      Copyright (C) 2020  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU General Public License as published by
+      the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+      GNU General Public License for more details.
+
+      You should have received a copy of the GNU General Public License
+      along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef STEGANOGIF_INDEXED_GIF_STREAMER_H
+#define STEGANOGIF_INDEXED_GIF_STREAMER_H
+
+#include "indexed_picture.h"
+#include "quicky_exception.h"
+#include <ostream>
+#include <array>
+#include <vector>
+#include <cinttypes>
+
+namespace steganogif
+{
+    /**
+     * Write an animated GIF whose frames are directly provided as indexed
+     * pictures so that no intermediate file is needed
+     */
+    class indexed_gif_streamer
+    {
+      public:
+        /**
+         * Write GIF header and logical screen descriptor
+         * @param p_stream output stream
+         * @param p_width animation width
+         * @param p_height animation height
+         */
+        inline
+        indexed_gif_streamer( std::ostream & p_stream
+                            , unsigned int p_width
+                            , unsigned int p_height
+                            );
+
+        /**
+         * Append a full frame to animation, picture palette is stored as
+         * local color table of the frame
+         * @param p_picture frame content
+         */
+        inline
+        void send_picture(const indexed_picture & p_picture);
+
+        inline
+        void send_trailer();
+
+      private:
+
+        inline
+        void write_byte(uint8_t p_byte);
+
+        inline
+        void write_word(uint16_t p_word);
+
+        /**
+         * LZW compress palette indexes and write them as data sub-blocks
+         * @param p_indexes palette indexes
+         */
+        inline
+        void write_image_data(const std::vector<uint8_t> & p_indexes);
+
+        /**
+         * Pack a LZW code in output bit stream
+         * @param p_code code to pack
+         * @param p_nb_bits number of bits of code
+         */
+        inline
+        void write_code( unsigned int p_code
+                       , unsigned int p_nb_bits
+                       );
+
+        inline
+        void flush_sub_block();
+
+        /**
+         * Reset LZW string table
+         */
+        inline
+        void clear_table();
+
+        static constexpr unsigned int m_min_code_size = 8;
+        static constexpr unsigned int m_clear_code = 1u << m_min_code_size;
+        static constexpr unsigned int m_end_code = m_clear_code + 1;
+        static constexpr unsigned int m_max_code = 4096;
+
+        /**
+         * Hash table size, kept twice bigger than max number of codes
+         */
+        static constexpr unsigned int m_table_size = 2 * m_max_code;
+
+        std::ostream & m_stream;
+        unsigned int m_width;
+        unsigned int m_height;
+
+        uint32_t m_bit_buffer;
+        unsigned int m_nb_bits;
+        std::array<uint8_t, 255> m_sub_block;
+        unsigned int m_sub_block_size;
+
+        /**
+         * LZW string table: key is prefix code and next index, 0 means
+         * free entry
+         */
+        std::vector<uint32_t> m_table_keys;
+        std::vector<uint16_t> m_table_codes;
+    };
+
+    //-------------------------------------------------------------------------
+    indexed_gif_streamer::indexed_gif_streamer( std::ostream & p_stream
+                                              , unsigned int p_width
+                                              , unsigned int p_height
+                                              )
+    : m_stream(p_stream)
+    , m_width(p_width)
+    , m_height(p_height)
+    , m_bit_buffer(0)
+    , m_nb_bits(0)
+    , m_sub_block{}
+    , m_sub_block_size(0)
+    , m_table_keys(m_table_size, 0)
+    , m_table_codes(m_table_size, 0)
+    {
+        if(p_width > 0xFFFF || p_height > 0xFFFF)
+        {
+            throw quicky_exception::quicky_logic_exception("GIF dimensions are limited to 65535", __LINE__, __FILE__);
+        }
+        m_stream.write("GIF89a", 6);
+
+        // Logical screen descriptor without global color table, 8 bits color resolution
+        write_word(m_width);
+        write_word(m_height);
+        write_byte(0x70);
+        write_byte(0);
+        write_byte(0);
+
+        // Netscape application extension to loop on animation
+        write_byte(0x21);
+        write_byte(0xFF);
+        write_byte(11);
+        m_stream.write("NETSCAPE2.0", 11);
+        write_byte(3);
+        write_byte(1);
+        write_word(0);
+        write_byte(0);
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    indexed_gif_streamer::send_picture(const indexed_picture & p_picture)
+    {
+        if(p_picture.get_width() != m_width || p_picture.get_height() != m_height)
+        {
+            throw quicky_exception::quicky_logic_exception("Picture dimensions differ from animation ones", __LINE__, __FILE__);
+        }
+
+        // Graphic control extension: no disposal, 100ms delay, no transparency
+        write_byte(0x21);
+        write_byte(0xF9);
+        write_byte(4);
+        write_byte(1 << 2);
+        write_word(10);
+        write_byte(0);
+        write_byte(0);
+
+        // Image descriptor with 256 entries local color table
+        write_byte(0x2C);
+        write_word(0);
+        write_word(0);
+        write_word(m_width);
+        write_word(m_height);
+        write_byte(0x87);
+        for(unsigned int l_index = 0; l_index < 256; ++l_index)
+        {
+            const lib_bmp::my_color & l_color = p_picture.get_color(l_index);
+            write_byte(l_color.get_red());
+            write_byte(l_color.get_green());
+            write_byte(l_color.get_blue());
+        }
+
+        write_image_data(p_picture.get_indexes());
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    indexed_gif_streamer::send_trailer()
+    {
+        write_byte(0x3B);
+        m_stream.flush();
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    indexed_gif_streamer::write_byte(uint8_t p_byte)
+    {
+        m_stream.put((char)p_byte);
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    indexed_gif_streamer::write_word(uint16_t p_word)
+    {
+        write_byte(p_word & 0xFF);
+        write_byte(p_word >> 8);
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    indexed_gif_streamer::clear_table()
+    {
+        std::fill(m_table_keys.begin(), m_table_keys.end(), 0);
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    indexed_gif_streamer::write_image_data(const std::vector<uint8_t> & p_indexes)
+    {
+        write_byte(m_min_code_size);
+        if(p_indexes.empty())
+        {
+            throw quicky_exception::quicky_logic_exception("Empty picture", __LINE__, __FILE__);
+        }
+
+        clear_table();
+        unsigned int l_code_size = m_min_code_size + 1;
+        unsigned int l_next_code = m_end_code + 1;
+        write_code(m_clear_code, l_code_size);
+
+        unsigned int l_prefix = p_indexes[0];
+        for(size_t l_pixel = 1; l_pixel < p_indexes.size(); ++l_pixel)
+        {
+            uint8_t l_index = p_indexes[l_pixel];
+            // Keys are offset by one to keep 0 as free entry marker
+            uint32_t l_key = ((l_prefix << 8) | l_index) + 1;
+            unsigned int l_slot = (l_key * 2654435761u) >> 19;
+            while(m_table_keys[l_slot] && m_table_keys[l_slot] != l_key)
+            {
+                l_slot = (l_slot + 1) & (m_table_size - 1);
+            }
+            if(m_table_keys[l_slot])
+            {
+                l_prefix = m_table_codes[l_slot];
+                continue;
+            }
+            write_code(l_prefix, l_code_size);
+            if(l_next_code < m_max_code)
+            {
+                // Decoder will only know this code once next one is read
+                // so code size increase when next code no more fit
+                if(l_next_code == (1u << l_code_size))
+                {
+                    ++l_code_size;
+                }
+                m_table_keys[l_slot] = l_key;
+                m_table_codes[l_slot] = l_next_code;
+                ++l_next_code;
+            }
+            else
+            {
+                write_code(m_clear_code, l_code_size);
+                clear_table();
+                l_code_size = m_min_code_size + 1;
+                l_next_code = m_end_code + 1;
+            }
+            l_prefix = l_index;
+        }
+        write_code(l_prefix, l_code_size);
+        write_code(m_end_code, l_code_size);
+
+        // Flush remaining bits and close data sub-blocks
+        if(m_nb_bits)
+        {
+            m_sub_block[m_sub_block_size++] = m_bit_buffer & 0xFF;
+            m_bit_buffer = 0;
+            m_nb_bits = 0;
+        }
+        flush_sub_block();
+        write_byte(0);
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    indexed_gif_streamer::write_code( unsigned int p_code
+                                    , unsigned int p_nb_bits
+                                    )
+    {
+        m_bit_buffer |= p_code << m_nb_bits;
+        m_nb_bits += p_nb_bits;
+        while(m_nb_bits >= 8)
+        {
+            m_sub_block[m_sub_block_size++] = m_bit_buffer & 0xFF;
+            m_bit_buffer >>= 8;
+            m_nb_bits -= 8;
+            if(m_sub_block.size() == m_sub_block_size)
+            {
+                flush_sub_block();
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    indexed_gif_streamer::flush_sub_block()
+    {
+        if(m_sub_block_size)
+        {
+            write_byte(m_sub_block_size);
+            m_stream.write((const char*)m_sub_block.data(), m_sub_block_size);
+            m_sub_block_size = 0;
+        }
+    }
+
+}
+#endif //STEGANOGIF_INDEXED_GIF_STREAMER_H
+// EOF
@@ -0,0 +1,285 @@
+/*
+      This file is part of steganogif
+      Copyright (C) 2020  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU General Public License as published by
+      the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+      GNU General Public License for more details.
+
+      You should have received a copy of the GNU General Public License
+      along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef STEGANOGIF_INDEXED_PICTURE_H
+#define STEGANOGIF_INDEXED_PICTURE_H
+
+#include "my_bmp.h"
+#include "quicky_exception.h"
+#include <array>
+#include <cassert>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <cinttypes>
+
+namespace steganogif
+{
+    /**
+     * 8 bits paletted picture kept in memory as a raw buffer of palette
+     * indexes stored row by row
+     */
+    class indexed_picture
+    {
+      public:
+        inline
+        indexed_picture( unsigned int p_width
+                       , unsigned int p_height
+                       );
+
+        /**
+         * Build indexed picture from a paletted BMP content
+         * @param p_bmp BMP content with at most 8 bits per pixel
+         */
+        inline explicit
+        indexed_picture(const lib_bmp::my_bmp & p_bmp);
+
+        inline
+        unsigned int get_width() const;
+
+        inline
+        unsigned int get_height() const;
+
+        inline
+        uint8_t get_index( unsigned int p_x
+                         , unsigned int p_y
+                         ) const;
+
+        inline
+        void set_index( unsigned int p_x
+                      , unsigned int p_y
+                      , uint8_t p_index
+                      );
+
+        inline
+        const lib_bmp::my_color & get_color(unsigned int p_index) const;
+
+        inline
+        void set_color( unsigned int p_index
+                      , const lib_bmp::my_color & p_color
+                      );
+
+        /**
+         * Replace palette by another one made of same colors in a
+         * different order, indexes are updated accordingly
+         * @param p_palette new palette colors, at most 256
+         */
+        inline
+        void reorder_palette(const std::vector<lib_bmp::my_color> & p_palette);
+
+        /**
+         * Raw access to palette indexes, stored row by row
+         * @return palette indexes
+         */
+        inline
+        const std::vector<uint8_t> & get_indexes() const;
+
+        inline
+        std::vector<uint8_t> & get_indexes();
+
+        /**
+         * Convert indexed picture to BMP content, used to dump pictures
+         * @return BMP content
+         */
+        inline
+        lib_bmp::my_bmp to_bmp() const;
+
+      private:
+        unsigned int m_width;
+        unsigned int m_height;
+        std::array<lib_bmp::my_color, 256> m_palette;
+        std::vector<uint8_t> m_indexes;
+    };
+
+    //-------------------------------------------------------------------------
+    indexed_picture::indexed_picture( unsigned int p_width
+                                    , unsigned int p_height
+                                    )
+    : m_width(p_width)
+    , m_height(p_height)
+    , m_indexes(p_width * p_height, 0)
+    {
+    }
+
+    //-------------------------------------------------------------------------
+    indexed_picture::indexed_picture(const lib_bmp::my_bmp & p_bmp)
+    : indexed_picture(p_bmp.get_width(), p_bmp.get_height())
+    {
+        if(p_bmp.get_nb_bits_per_pixel() > 8 || p_bmp.get_palette().get_size() > m_palette.size())
+        {
+            throw quicky_exception::quicky_logic_exception("Indexed picture require a paletted BMP", __LINE__, __FILE__);
+        }
+        std::map<lib_bmp::my_color, uint8_t> l_color_indexes;
+        for(unsigned int l_index = 0; l_index < p_bmp.get_palette().get_size(); ++l_index)
+        {
+            m_palette[l_index] = p_bmp.get_palette().get_color(l_index);
+            l_color_indexes.insert(std::make_pair(m_palette[l_index], (uint8_t)l_index));
+        }
+        for(unsigned int l_y = 0; l_y < m_height; ++l_y)
+        {
+            for(unsigned int l_x = 0; l_x < m_width; ++l_x)
+            {
+                lib_bmp::my_color l_color = p_bmp.get_pixel_color(l_x, l_y);
+                auto l_iter = l_color_indexes.find(l_color);
+                if(l_color_indexes.end() == l_iter)
+                {
+                    std::stringstream l_color_stream;
+                    l_color_stream << l_color;
+                    throw quicky_exception::quicky_logic_exception("Color " + l_color_stream.str() + " is not part of palette", __LINE__, __FILE__);
+                }
+                m_indexes[l_y * m_width + l_x] = l_iter->second;
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    unsigned int
+    indexed_picture::get_width() const
+    {
+        return m_width;
+    }
+
+    //-------------------------------------------------------------------------
+    unsigned int
+    indexed_picture::get_height() const
+    {
+        return m_height;
+    }
+
+    //-------------------------------------------------------------------------
+    uint8_t
+    indexed_picture::get_index( unsigned int p_x
+                              , unsigned int p_y
+                              ) const
+    {
+        assert(p_x < m_width && p_y < m_height);
+        return m_indexes[p_y * m_width + p_x];
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    indexed_picture::set_index( unsigned int p_x
+                              , unsigned int p_y
+                              , uint8_t p_index
+                              )
+    {
+        assert(p_x < m_width && p_y < m_height);
+        m_indexes[p_y * m_width + p_x] = p_index;
+    }
+
+    //-------------------------------------------------------------------------
+    const lib_bmp::my_color &
+    indexed_picture::get_color(unsigned int p_index) const
+    {
+        assert(p_index < m_palette.size());
+        return m_palette[p_index];
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    indexed_picture::set_color( unsigned int p_index
+                              , const lib_bmp::my_color & p_color
+                              )
+    {
+        assert(p_index < m_palette.size());
+        m_palette[p_index] = p_color;
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    indexed_picture::reorder_palette(const std::vector<lib_bmp::my_color> & p_palette)
+    {
+        if(p_palette.size() > m_palette.size())
+        {
+            throw quicky_exception::quicky_logic_exception("Palette should not have more than 256 colors", __LINE__, __FILE__);
+        }
+        std::map<lib_bmp::my_color, uint8_t> l_color_indexes;
+        for(unsigned int l_index = 0; l_index < p_palette.size(); ++l_index)
+        {
+            l_color_indexes.insert(std::make_pair(p_palette[l_index], (uint8_t)l_index));
+        }
+
+        // Compute new index of each index used by picture
+        std::array<bool, 256> l_used{};
+        for(auto l_index: m_indexes)
+        {
+            l_used[l_index] = true;
+        }
+        std::array<uint8_t, 256> l_new_indexes{};
+        for(unsigned int l_index = 0; l_index < m_palette.size(); ++l_index)
+        {
+            if(!l_used[l_index])
+            {
+                continue;
+            }
+            auto l_iter = l_color_indexes.find(m_palette[l_index]);
+            if(l_color_indexes.end() == l_iter)
+            {
+                std::stringstream l_color_stream;
+                l_color_stream << m_palette[l_index];
+                throw quicky_exception::quicky_logic_exception("Color " + l_color_stream.str() + " is not part of new palette", __LINE__, __FILE__);
+            }
+            l_new_indexes[l_index] = l_iter->second;
+        }
+
+        for(auto & l_index: m_indexes)
+        {
+            l_index = l_new_indexes[l_index];
+        }
+        for(unsigned int l_index = 0; l_index < m_palette.size(); ++l_index)
+        {
+            m_palette[l_index] = l_index < p_palette.size() ? p_palette[l_index] : lib_bmp::my_color();
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    const std::vector<uint8_t> &
+    indexed_picture::get_indexes() const
+    {
+        return m_indexes;
+    }
+
+    //-------------------------------------------------------------------------
+    std::vector<uint8_t> &
+    indexed_picture::get_indexes()
+    {
+        return m_indexes;
+    }
+
+    //-------------------------------------------------------------------------
+    lib_bmp::my_bmp
+    indexed_picture::to_bmp() const
+    {
+        lib_bmp::my_bmp l_bmp(m_width, m_height, 8);
+        for(unsigned int l_index = 0; l_index < m_palette.size(); ++l_index)
+        {
+            l_bmp.get_palette().set_color(lib_bmp::my_color_alpha(m_palette[l_index]), l_index);
+        }
+        for(unsigned int l_y = 0; l_y < m_height; ++l_y)
+        {
+            for(unsigned int l_x = 0; l_x < m_width; ++l_x)
+            {
+                l_bmp.set_pixel_color(l_x, l_y, lib_bmp::my_color_alpha(m_palette[m_indexes[l_y * m_width + l_x]]));
+            }
+        }
+        return l_bmp;
+    }
+
+}
+#endif //STEGANOGIF_INDEXED_PICTURE_H
+// EOF
@@ -0,0 +1,183 @@
+/*
+      This file is part of steganogif
+      Copyright (C) 2020  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU General Public License as published by
+      the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+      GNU General Public License for more details.
+
+      You should have received a copy of the GNU General Public License
+      along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef STEGANOGIF_KEYED_PERMUTATION_H
+#define STEGANOGIF_KEYED_PERMUTATION_H
+
+#include "quicky_exception.h"
+#include <array>
+#include <cassert>
+#include <cinttypes>
+
+namespace steganogif
+{
+    /**
+     * Bijection of [0:size[ derived from a key. Image of any index is
+     * computed in constant time by a balanced Feistel network working on
+     * the smallest even number of bits covering size, cycle walking
+     * bringing back results outside of [0:size[ into it.
+     * A keyed bit is also associated to each index.
+     */
+    class keyed_permutation
+    {
+      public:
+        /**
+         * Constructor
+         * @param p_size permutation size
+         * @param p_keys key, typically password hash
+         * @param p_tweak value distinguishing permutations built with same key, typically frame index
+         */
+        inline
+        keyed_permutation( uint32_t p_size
+                         , const std::array<uint32_t, 5> & p_keys
+                         , uint32_t p_tweak
+                         );
+
+        inline
+        uint32_t get_size() const;
+
+        /**
+         * Image of index by permutation
+         * @param p_index index in [0:size[
+         * @return image in [0:size[
+         */
+        inline
+        uint32_t operator()(uint32_t p_index) const;
+
+        /**
+         * Keyed pseudo random bit associated to index
+         * @param p_index index
+         * @return bit value
+         */
+        inline
+        bool get_bit(uint32_t p_index) const;
+
+      private:
+
+        /**
+         * Permutation of [0:2^(2*half_bits)[
+         * @param p_value value to permute
+         * @return permuted value
+         */
+        inline
+        uint32_t feistel(uint32_t p_value) const;
+
+        /**
+         * Bijective 32 bits mixing function
+         * @param p_value value to mix
+         * @return mixed value
+         */
+        inline static
+        uint32_t mix(uint32_t p_value);
+
+        static constexpr unsigned int m_nb_rounds = 6;
+
+        uint32_t m_size;
+        unsigned int m_half_bits;
+        uint32_t m_half_mask;
+        std::array<uint32_t, m_nb_rounds> m_round_keys;
+        uint32_t m_bit_key;
+    };
+
+    //-------------------------------------------------------------------------
+    keyed_permutation::keyed_permutation( uint32_t p_size
+                                        , const std::array<uint32_t, 5> & p_keys
+                                        , uint32_t p_tweak
+                                        )
+    : m_size(p_size)
+    , m_half_bits(1)
+    , m_half_mask(0)
+    , m_round_keys{}
+    , m_bit_key(0)
+    {
+        if(!p_size)
+        {
+            throw quicky_exception::quicky_logic_exception("Permutation size should not be zero", __LINE__, __FILE__);
+        }
+        while(m_half_bits < 16 && (1ull << (2 * m_half_bits)) < p_size)
+        {
+            ++m_half_bits;
+        }
+        m_half_mask = (1u << m_half_bits) - 1;
+
+        uint32_t l_tweak = mix(p_tweak ^ 0x9E3779B9);
+        for(unsigned int l_round = 0; l_round < m_nb_rounds; ++l_round)
+        {
+            l_tweak = mix(l_tweak + p_keys[l_round % p_keys.size()] + l_round);
+            m_round_keys[l_round] = l_tweak;
+        }
+        m_bit_key = mix(l_tweak ^ p_keys[m_nb_rounds % p_keys.size()]);
+    }
+
+    //-------------------------------------------------------------------------
+    uint32_t
+    keyed_permutation::get_size() const
+    {
+        return m_size;
+    }
+
+    //-------------------------------------------------------------------------
+    uint32_t
+    keyed_permutation::operator()(uint32_t p_index) const
+    {
+        assert(p_index < m_size);
+        uint32_t l_result = feistel(p_index);
+        while(l_result >= m_size)
+        {
+            l_result = feistel(l_result);
+        }
+        return l_result;
+    }
+
+    //-------------------------------------------------------------------------
+    bool
+    keyed_permutation::get_bit(uint32_t p_index) const
+    {
+        return mix((p_index >> 5) ^ m_bit_key) & (1u << (p_index & 0x1F));
+    }
+
+    //-------------------------------------------------------------------------
+    uint32_t
+    keyed_permutation::feistel(uint32_t p_value) const
+    {
+        uint32_t l_left = p_value >> m_half_bits;
+        uint32_t l_right = p_value & m_half_mask;
+        for(auto l_round_key: m_round_keys)
+        {
+            uint32_t l_new_right = l_left ^ (mix(l_right ^ l_round_key) & m_half_mask);
+            l_left = l_right;
+            l_right = l_new_right;
+        }
+        return (l_left << m_half_bits) | l_right;
+    }
+
+    //-------------------------------------------------------------------------
+    uint32_t
+    keyed_permutation::mix(uint32_t p_value)
+    {
+        p_value ^= p_value >> 16;
+        p_value *= 0x85EBCA6B;
+        p_value ^= p_value >> 13;
+        p_value *= 0xC2B2AE35;
+        p_value ^= p_value >> 16;
+        return p_value;
+    }
+
+}
+#endif //STEGANOGIF_KEYED_PERMUTATION_H
+// EOF
@@ -0,0 +1,127 @@
+/*
+      This file is part of steganogif
+      Copyright (C) 2020  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU General Public License as published by
+      the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+      GNU General Public License for more details.
+
+      You should have received a copy of the GNU General Public License
+      along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef STEGANOGIF_MAPPED_FILE_H
+#define STEGANOGIF_MAPPED_FILE_H
+
+#if __has_include(<sys/mman.h>)
+#define STEGANOGIF_MAPPED_FILE_SUPPORTED
+
+#include "quicky_exception.h"
+#include <string>
+#include <cinttypes>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace steganogif
+{
+    /**
+     * Read only memory mapping of a whole file, content being accessed
+     * from page cache without copy
+     */
+    class mapped_file
+    {
+      public:
+        /**
+         * Map file
+         * @param p_file_name name of file to map
+         */
+        inline explicit
+        mapped_file(const std::string & p_file_name);
+
+        inline
+        ~mapped_file();
+
+        mapped_file(const mapped_file &) = delete;
+
+        mapped_file & operator=(const mapped_file &) = delete;
+
+        inline
+        const uint8_t * get_data() const;
+
+        inline
+        size_t get_size() const;
+
+      private:
+        void * m_data;
+        size_t m_size;
+    };
+
+    //-------------------------------------------------------------------------
+    mapped_file::mapped_file(const std::string & p_file_name)
+    : m_data(MAP_FAILED)
+    , m_size(0)
+    {
+        int l_file_descriptor = open(p_file_name.c_str(), O_RDONLY);
+        if(-1 == l_file_descriptor)
+        {
+            throw quicky_exception::quicky_runtime_exception(R"(Unable to read file ")" + p_file_name + R"(")", __LINE__, __FILE__);
+        }
+        struct stat l_stat;
+        if(fstat(l_file_descriptor, & l_stat))
+        {
+            close(l_file_descriptor);
+            throw quicky_exception::quicky_runtime_exception(R"(Unable to get size of file ")" + p_file_name + R"(")", __LINE__, __FILE__);
+        }
+        m_size = l_stat.st_size;
+        // Empty files cannot be mapped
+        if(m_size)
+        {
+            m_data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, l_file_descriptor, 0);
+        }
+        close(l_file_descriptor);
+        if(m_size && MAP_FAILED == m_data)
+        {
+            throw quicky_exception::quicky_runtime_exception(R"(Unable to map file ")" + p_file_name + R"(")", __LINE__, __FILE__);
+        }
+        if(m_size)
+        {
+            // File is mainly read from start to end
+            madvise(m_data, m_size, MADV_SEQUENTIAL);
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    mapped_file::~mapped_file()
+    {
+        if(MAP_FAILED != m_data)
+        {
+            munmap(m_data, m_size);
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    const uint8_t *
+    mapped_file::get_data() const
+    {
+        return MAP_FAILED != m_data ? (const uint8_t*)m_data : nullptr;
+    }
+
+    //-------------------------------------------------------------------------
+    size_t
+    mapped_file::get_size() const
+    {
+        return m_size;
+    }
+
+}
+#endif // __has_include(<sys/mman.h>)
+#endif //STEGANOGIF_MAPPED_FILE_H
+// EOF
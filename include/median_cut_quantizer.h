@@ -0,0 +1,341 @@
+/*
+      This file is part of steganogif
+      Copyright (C) 2020  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU General Public License as published by
+      the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+      GNU General Public License for more details.
+
+      You should have received a copy of the GNU General Public License
+      along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef STEGANOGIF_MEDIAN_CUT_QUANTIZER_H
+#define STEGANOGIF_MEDIAN_CUT_QUANTIZER_H
+
+#include "indexed_picture.h"
+#include "my_bmp.h"
+#include <array>
+#include <vector>
+#include <cassert>
+#include <cinttypes>
+
+namespace steganogif
+{
+    /**
+     * Reduce a picture to a 128 colors palette adapted to its content.
+     * Pixels are counted in a histogram of 32768 bins keeping 5 bits per
+     * component, then the box of bins holding most pixels, weighted by its
+     * longest side, is repeatedly split at the median of this side. Each
+     * palette color is the average of pixels of a box and pixels are
+     * converted with a table giving box of each bin, so picture is only
+     * walked twice and memory does not depend on its size
+     */
+    class median_cut_quantizer
+    {
+      public:
+        /**
+         * Quantize picture
+         * @param p_bmp BMP content to quantize
+         * @return picture whose 128 first palette entries are distinct
+         * colors, remaining ones being black
+         */
+        inline static
+        indexed_picture quantize(const lib_bmp::my_bmp & p_bmp);
+
+        static constexpr unsigned int m_nb_colors = 128;
+
+      private:
+
+        static constexpr unsigned int m_nb_bits = 5;
+        static constexpr unsigned int m_nb_levels = 1u << m_nb_bits;
+        static constexpr unsigned int m_nb_bins = 1u << (3 * m_nb_bits);
+
+        /**
+         * Box of bins, bounds being included
+         */
+        struct box
+        {
+            std::array<unsigned int, 3> m_min;
+            std::array<unsigned int, 3> m_max;
+            uint64_t m_nb_pixels;
+        };
+
+        inline static
+        unsigned int get_bin(const lib_bmp::my_color & p_color);
+
+        inline static
+        unsigned int get_bin( unsigned int p_red
+                            , unsigned int p_green
+                            , unsigned int p_blue
+                            );
+
+        /**
+         * Call functor on each bin of box
+         * @param p_box box
+         * @param p_functor functor receiving bin coordinates and index
+         */
+        template <typename FUNCTOR>
+        inline static
+        void for_each_bin( const box & p_box
+                         , FUNCTOR p_functor
+                         );
+
+        /**
+         * Reduce box to bounds of its non empty bins and count its pixels
+         * @param p_box box to shrink
+         * @param p_histogram number of pixels of each bin
+         */
+        inline static
+        void shrink( box & p_box
+                   , const std::vector<uint32_t> & p_histogram
+                   );
+
+        /**
+         * Split box along its longest side so that both parts hold as
+         * close as possible to half of its pixels
+         * @param p_box box to split, receiving first part
+         * @param p_histogram number of pixels of each bin
+         * @return second part
+         */
+        inline static
+        box split( box & p_box
+                 , const std::vector<uint32_t> & p_histogram
+                 );
+
+        /**
+         * Axis of longest side of box
+         */
+        inline static
+        unsigned int get_longest_axis(const box & p_box);
+    };
+
+    //-------------------------------------------------------------------------
+    unsigned int
+    median_cut_quantizer::get_bin(const lib_bmp::my_color & p_color)
+    {
+        return get_bin( p_color.get_red() >> (8 - m_nb_bits)
+                      , p_color.get_green() >> (8 - m_nb_bits)
+                      , p_color.get_blue() >> (8 - m_nb_bits)
+                      );
+    }
+
+    //-------------------------------------------------------------------------
+    unsigned int
+    median_cut_quantizer::get_bin( unsigned int p_red
+                                 , unsigned int p_green
+                                 , unsigned int p_blue
+                                 )
+    {
+        return (p_red << (2 * m_nb_bits)) | (p_green << m_nb_bits) | p_blue;
+    }
+
+    //-------------------------------------------------------------------------
+    template <typename FUNCTOR>
+    void
+    median_cut_quantizer::for_each_bin( const box & p_box
+                                      , FUNCTOR p_functor
+                                      )
+    {
+        for(unsigned int l_red = p_box.m_min[0]; l_red <= p_box.m_max[0]; ++l_red)
+        {
+            for(unsigned int l_green = p_box.m_min[1]; l_green <= p_box.m_max[1]; ++l_green)
+            {
+                for(unsigned int l_blue = p_box.m_min[2]; l_blue <= p_box.m_max[2]; ++l_blue)
+                {
+                    p_functor(std::array<unsigned int, 3>{l_red, l_green, l_blue}, get_bin(l_red, l_green, l_blue));
+                }
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    median_cut_quantizer::shrink( box & p_box
+                                , const std::vector<uint32_t> & p_histogram
+                                )
+    {
+        box l_shrunk{{m_nb_levels, m_nb_levels, m_nb_levels}, {0, 0, 0}, 0};
+        for_each_bin(p_box, [&](const std::array<unsigned int, 3> & p_coordinates, unsigned int p_bin)
+        {
+            if(p_histogram[p_bin])
+            {
+                for(unsigned int l_axis = 0; l_axis < 3; ++l_axis)
+                {
+                    l_shrunk.m_min[l_axis] = std::min(l_shrunk.m_min[l_axis], p_coordinates[l_axis]);
+                    l_shrunk.m_max[l_axis] = std::max(l_shrunk.m_max[l_axis], p_coordinates[l_axis]);
+                }
+                l_shrunk.m_nb_pixels += p_histogram[p_bin];
+            }
+        });
+        assert(l_shrunk.m_nb_pixels);
+        p_box = l_shrunk;
+    }
+
+    //-------------------------------------------------------------------------
+    unsigned int
+    median_cut_quantizer::get_longest_axis(const box & p_box)
+    {
+        unsigned int l_longest_axis = 0;
+        for(unsigned int l_axis = 1; l_axis < 3; ++l_axis)
+        {
+            if(p_box.m_max[l_axis] - p_box.m_min[l_axis] > p_box.m_max[l_longest_axis] - p_box.m_min[l_longest_axis])
+            {
+                l_longest_axis = l_axis;
+            }
+        }
+        return l_longest_axis;
+    }
+
+    //-------------------------------------------------------------------------
+    median_cut_quantizer::box
+    median_cut_quantizer::split( box & p_box
+                               , const std::vector<uint32_t> & p_histogram
+                               )
+    {
+        unsigned int l_axis = get_longest_axis(p_box);
+        assert(p_box.m_max[l_axis] > p_box.m_min[l_axis]);
+
+        // Number of pixels of each plane orthogonal to split axis
+        std::array<uint64_t, m_nb_levels> l_planes{};
+        for_each_bin(p_box, [&](const std::array<unsigned int, 3> & p_coordinates, unsigned int p_bin)
+        {
+            l_planes[p_coordinates[l_axis]] += p_histogram[p_bin];
+        });
+
+        // Box being shrunk its first and last planes are not empty so each
+        // part keeps some pixels as long as last plane goes to second one
+        unsigned int l_last_plane = p_box.m_min[l_axis];
+        uint64_t l_nb_pixels = l_planes[l_last_plane];
+        while(l_last_plane + 1 < p_box.m_max[l_axis] && 2 * l_nb_pixels < p_box.m_nb_pixels)
+        {
+            ++l_last_plane;
+            l_nb_pixels += l_planes[l_last_plane];
+        }
+
+        box l_second = p_box;
+        p_box.m_max[l_axis] = l_last_plane;
+        l_second.m_min[l_axis] = l_last_plane + 1;
+        shrink(p_box, p_histogram);
+        shrink(l_second, p_histogram);
+        return l_second;
+    }
+
+    //-------------------------------------------------------------------------
+    indexed_picture
+    median_cut_quantizer::quantize(const lib_bmp::my_bmp & p_bmp)
+    {
+        // Number of pixels and sum of their components for each bin
+        std::vector<uint32_t> l_histogram(m_nb_bins, 0);
+        std::vector<std::array<uint64_t, 3>> l_sums(m_nb_bins, std::array<uint64_t, 3>{0, 0, 0});
+        for(unsigned int l_y = 0; l_y < p_bmp.get_height(); ++l_y)
+        {
+            for(unsigned int l_x = 0; l_x < p_bmp.get_width(); ++l_x)
+            {
+                lib_bmp::my_color l_color = p_bmp.get_pixel_color(l_x, l_y);
+                unsigned int l_bin = get_bin(l_color);
+                ++l_histogram[l_bin];
+                l_sums[l_bin][0] += l_color.get_red();
+                l_sums[l_bin][1] += l_color.get_green();
+                l_sums[l_bin][2] += l_color.get_blue();
+            }
+        }
+
+        std::vector<box> l_boxes;
+        l_boxes.reserve(m_nb_colors);
+        if(p_bmp.get_width() && p_bmp.get_height())
+        {
+            l_boxes.push_back(box{{0, 0, 0}, {m_nb_levels - 1, m_nb_levels - 1, m_nb_levels - 1}, 0});
+            shrink(l_boxes.front(), l_histogram);
+        }
+        while(l_boxes.size() < m_nb_colors)
+        {
+            // Boxes reduced to one bin cannot be split
+            unsigned int l_selected = m_nb_colors;
+            uint64_t l_selected_weight = 0;
+            for(unsigned int l_index = 0; l_index < l_boxes.size(); ++l_index)
+            {
+                const box & l_box = l_boxes[l_index];
+                unsigned int l_axis = get_longest_axis(l_box);
+                uint64_t l_weight = l_box.m_nb_pixels * (l_box.m_max[l_axis] - l_box.m_min[l_axis]);
+                if(l_weight > l_selected_weight)
+                {
+                    l_selected = l_index;
+                    l_selected_weight = l_weight;
+                }
+            }
+            if(m_nb_colors == l_selected)
+            {
+                break;
+            }
+            box l_second = split(l_boxes[l_selected], l_histogram);
+            l_boxes.push_back(l_second);
+        }
+
+        // Boxes are disjoint so averages of their pixels are distinct
+        indexed_picture l_picture{p_bmp.get_width(), p_bmp.get_height()};
+        const uint8_t l_no_box = m_nb_colors;
+        std::vector<uint8_t> l_box_indexes(m_nb_bins, l_no_box);
+        for(unsigned int l_index = 0; l_index < l_boxes.size(); ++l_index)
+        {
+            std::array<uint64_t, 3> l_sum{0, 0, 0};
+            for_each_bin(l_boxes[l_index], [&](const std::array<unsigned int, 3> &, unsigned int p_bin)
+            {
+                l_box_indexes[p_bin] = l_index;
+                for(unsigned int l_component = 0; l_component < 3; ++l_component)
+                {
+                    l_sum[l_component] += l_sums[p_bin][l_component];
+                }
+            });
+            uint64_t l_nb_pixels = l_boxes[l_index].m_nb_pixels;
+            l_picture.set_color( l_index
+                               , lib_bmp::my_color( (l_sum[0] + l_nb_pixels / 2) / l_nb_pixels
+                                                  , (l_sum[1] + l_nb_pixels / 2) / l_nb_pixels
+                                                  , (l_sum[2] + l_nb_pixels / 2) / l_nb_pixels
+                                                  )
+                               );
+        }
+
+        // When picture has too few colors remaining entries are centers of
+        // bins outside boxes. Bins are visited with an odd stride to spread
+        // these colors
+        unsigned int l_bin = 0;
+        for(unsigned int l_index = l_boxes.size(); l_index < m_nb_colors; ++l_index)
+        {
+            do
+            {
+                l_bin = (l_bin + 2731) % m_nb_bins;
+            }
+            while(l_no_box != l_box_indexes[l_bin]);
+            l_box_indexes[l_bin] = l_index;
+            unsigned int l_half = 1u << (7 - m_nb_bits);
+            l_picture.set_color( l_index
+                               , lib_bmp::my_color( ((l_bin >> (2 * m_nb_bits)) << (8 - m_nb_bits)) | l_half
+                                                  , (((l_bin >> m_nb_bits) % m_nb_levels) << (8 - m_nb_bits)) | l_half
+                                                  , ((l_bin % m_nb_levels) << (8 - m_nb_bits)) | l_half
+                                                  )
+                               );
+        }
+
+        std::vector<uint8_t> & l_indexes = l_picture.get_indexes();
+        unsigned int l_width = p_bmp.get_width();
+        for(unsigned int l_y = 0; l_y < p_bmp.get_height(); ++l_y)
+        {
+            uint8_t * l_row = l_indexes.data() + l_y * l_width;
+            for(unsigned int l_x = 0; l_x < l_width; ++l_x)
+            {
+                l_row[l_x] = l_box_indexes[get_bin(p_bmp.get_pixel_color(l_x, l_y))];
+            }
+        }
+        return l_picture;
+    }
+
+}
+#endif //STEGANOGIF_MEDIAN_CUT_QUANTIZER_H
+// EOF
@@ -0,0 +1,286 @@
+/*
+      This file is part of steganogif
+      Copyright (C) 2020  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU General Public License as published by
+      the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+      GNU General Public License for more details.
+
+      You should have received a copy of the GNU General Public License
+      along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef STEGANOGIF_PALETTE_PAIRING_H
+#define STEGANOGIF_PALETTE_PAIRING_H
+
+#include "my_color.h"
+#include "quicky_exception.h"
+#include "index_kernels.h"
+#include <array>
+#include <vector>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+#include <cinttypes>
+
+namespace steganogif
+{
+    /**
+     * Color correspondance expressed with palette indexes. Each palette
+     * index is associated to the index of the lower and upper colors of
+     * its pair, a bit being encoded by choosing one of them
+     */
+    class palette_pairing
+    {
+      public:
+        /**
+         * Identity pairing where each index is associated to itself
+         */
+        inline
+        palette_pairing();
+
+        /**
+         * Constructor
+         * @param p_palette palette colors, at most 256
+         * @param p_color_correspondance color correspondance
+         */
+        inline
+        palette_pairing( const std::vector<lib_bmp::my_color> & p_palette
+                       , const std::map<lib_bmp::my_color, lib_bmp::my_color> & p_color_correspondance
+                       );
+
+        /**
+         * Index encoding a bit
+         * @param p_index current palette index of pixel
+         * @param p_value bit to encode
+         * @return upper color index of pair if bit is set, lower one otherwise
+         */
+        inline
+        uint8_t encode( uint8_t p_index
+                      , bool p_value
+                      ) const;
+
+        /**
+         * Bit encoded by an index
+         * @param p_index palette index of pixel
+         * @return true if index color is the upper one of its pair
+         */
+        inline
+        bool decode(uint8_t p_index) const;
+
+        /**
+         * Encode one bit per index
+         * @param p_indexes palette indexes
+         * @param p_bits bits to encode, one per byte with value 0 or 1
+         */
+        inline
+        void encode( std::vector<uint8_t> & p_indexes
+                   , const std::vector<uint8_t> & p_bits
+                   ) const;
+
+        /**
+         * Decode one bit per index
+         * @param p_indexes palette indexes
+         * @param p_bits receive bits, one per byte with value 0 or 1
+         */
+        inline
+        void decode( const std::vector<uint8_t> & p_indexes
+                   , std::vector<uint8_t> & p_bits
+                   ) const;
+
+        /**
+         * Indicate if each pair is stored at indexes 2k and 2k+1 with lower
+         * color first, allowing use of index_kernels
+         * @return true if pairs are adjacent
+         */
+        inline
+        bool is_adjacent() const;
+
+        /**
+         * Reorder palette so that each pair is stored at indexes 2k and 2k+1
+         * with lower color first
+         * @param p_palette palette colors, at most 256
+         * @param p_color_correspondance color correspondance
+         * @return reordered palette colors
+         */
+        inline static
+        std::vector<lib_bmp::my_color> compute_adjacent_palette( const std::vector<lib_bmp::my_color> & p_palette
+                                                               , const std::map<lib_bmp::my_color, lib_bmp::my_color> & p_color_correspondance
+                                                               );
+
+      private:
+        /**
+         * Target index for each palette index and bit value, stored at
+         * 2 * index + value
+         */
+        std::array<uint8_t, 512> m_targets;
+
+        /**
+         * Bit value associated to each palette index
+         */
+        std::array<uint8_t, 256> m_values;
+
+        bool m_adjacent;
+    };
+
+    //-------------------------------------------------------------------------
+    palette_pairing::palette_pairing()
+    : m_values{}
+    , m_adjacent(false)
+    {
+        for(unsigned int l_index = 0; l_index < m_values.size(); ++l_index)
+        {
+            m_targets[2 * l_index] = l_index;
+            m_targets[2 * l_index + 1] = l_index;
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    palette_pairing::palette_pairing( const std::vector<lib_bmp::my_color> & p_palette
+                                    , const std::map<lib_bmp::my_color, lib_bmp::my_color> & p_color_correspondance
+                                    )
+    : palette_pairing()
+    {
+        if(p_palette.size() > m_values.size())
+        {
+            throw quicky_exception::quicky_logic_exception("Palette should not have more than 256 colors", __LINE__, __FILE__);
+        }
+
+        // In case of duplicated colors the first index is kept
+        std::map<lib_bmp::my_color, uint8_t> l_color_indexes;
+        for(unsigned int l_index = 0; l_index < p_palette.size(); ++l_index)
+        {
+            l_color_indexes.insert(std::make_pair(p_palette[l_index], (uint8_t)l_index));
+        }
+
+        for(unsigned int l_index = 0; l_index < p_palette.size(); ++l_index)
+        {
+            const lib_bmp::my_color & l_color = p_palette[l_index];
+            auto l_iter = p_color_correspondance.find(l_color);
+            auto l_related_iter = l_iter != p_color_correspondance.end() ? l_color_indexes.find(l_iter->second) : l_color_indexes.end();
+            if(l_color_indexes.end() == l_related_iter)
+            {
+                std::stringstream l_color_stream;
+                l_color_stream << l_color;
+                throw quicky_exception::quicky_logic_exception("No related color in palette for color " + l_color_stream.str(), __LINE__, __FILE__);
+            }
+            const lib_bmp::my_color & l_related_color = l_iter->second;
+            uint8_t l_own_index = l_color_indexes[l_color];
+            bool l_upper = l_related_color < l_color;
+            m_values[l_index] = l_upper;
+            m_targets[2 * l_index] = l_upper ? l_related_iter->second : l_own_index;
+            m_targets[2 * l_index + 1] = l_upper ? l_own_index : l_related_iter->second;
+        }
+
+        m_adjacent = true;
+        for(unsigned int l_index = 0; m_adjacent && l_index < m_values.size(); ++l_index)
+        {
+            m_adjacent = m_targets[2 * l_index] == (l_index & 0xFE) && m_targets[2 * l_index + 1] == (l_index | 1);
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    uint8_t
+    palette_pairing::encode( uint8_t p_index
+                           , bool p_value
+                           ) const
+    {
+        return m_targets[2 * p_index + p_value];
+    }
+
+    //-------------------------------------------------------------------------
+    bool
+    palette_pairing::decode(uint8_t p_index) const
+    {
+        return m_values[p_index];
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    palette_pairing::encode( std::vector<uint8_t> & p_indexes
+                           , const std::vector<uint8_t> & p_bits
+                           ) const
+    {
+        assert(p_indexes.size() == p_bits.size());
+        if(m_adjacent)
+        {
+            index_kernels::embed(p_indexes.data(), p_bits.data(), p_indexes.size());
+            return;
+        }
+        for(size_t l_index = 0; l_index < p_indexes.size(); ++l_index)
+        {
+            p_indexes[l_index] = m_targets[2 * p_indexes[l_index] + p_bits[l_index]];
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    palette_pairing::decode( const std::vector<uint8_t> & p_indexes
+                           , std::vector<uint8_t> & p_bits
+                           ) const
+    {
+        p_bits.resize(p_indexes.size());
+        if(m_adjacent)
+        {
+            index_kernels::extract(p_indexes.data(), p_bits.data(), p_indexes.size());
+            return;
+        }
+        for(size_t l_index = 0; l_index < p_indexes.size(); ++l_index)
+        {
+            p_bits[l_index] = m_values[p_indexes[l_index]];
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    bool
+    palette_pairing::is_adjacent() const
+    {
+        return m_adjacent;
+    }
+
+    //-------------------------------------------------------------------------
+    std::vector<lib_bmp::my_color>
+    palette_pairing::compute_adjacent_palette( const std::vector<lib_bmp::my_color> & p_palette
+                                             , const std::map<lib_bmp::my_color, lib_bmp::my_color> & p_color_correspondance
+                                             )
+    {
+        std::vector<lib_bmp::my_color> l_palette;
+        std::set<lib_bmp::my_color> l_placed_colors;
+        for(auto l_color: p_palette)
+        {
+            if(l_placed_colors.count(l_color))
+            {
+                continue;
+            }
+            auto l_iter = p_color_correspondance.find(l_color);
+            if(p_color_correspondance.end() == l_iter)
+            {
+                std::stringstream l_color_stream;
+                l_color_stream << l_color;
+                throw quicky_exception::quicky_logic_exception("No related color for color " + l_color_stream.str(), __LINE__, __FILE__);
+            }
+            lib_bmp::my_color l_lower_color = std::min(l_color, l_iter->second);
+            lib_bmp::my_color l_upper_color = std::max(l_color, l_iter->second);
+            l_palette.emplace_back(l_lower_color);
+            l_palette.emplace_back(l_upper_color);
+            l_placed_colors.insert(l_lower_color);
+            l_placed_colors.insert(l_upper_color);
+        }
+        if(l_palette.size() > 256)
+        {
+            throw quicky_exception::quicky_logic_exception("Palette should not have more than 256 colors", __LINE__, __FILE__);
+        }
+        return l_palette;
+    }
+
+}
+#endif //STEGANOGIF_PALETTE_PAIRING_H
+// EOF
@@ -0,0 +1,159 @@
+/*
+      This file is part of steganogif
+      Copyright (C) 2020  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU General Public License as published by
+      the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+      GNU General Public License for more details.
+
+      You should have received a copy of the GNU General Public License
+      along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef STEGANOGIF_PALETTE_PAIRING_CACHE_H
+#define STEGANOGIF_PALETTE_PAIRING_CACHE_H
+
+#include "palette_pairing.h"
+#include "my_color.h"
+#include <functional>
+#include <map>
+#include <vector>
+#include <tuple>
+#include <cinttypes>
+
+namespace steganogif
+{
+    /**
+     * Palette and pairing of each distinct GIF color table, computed once
+     * and then retrieved from a hash of color table content
+     */
+    class palette_pairing_cache
+    {
+      public:
+        /**
+         * Constructor
+         * @param p_compute function computing pairing of a color table and
+         * filling palette derived from it
+         */
+        inline explicit
+        palette_pairing_cache(std::function<palette_pairing(const std::vector<lib_bmp::my_color> &, std::vector<lib_bmp::my_color> &)> p_compute);
+
+        /**
+         * Get palette and pairing of a color table, computing them if color
+         * table was not yet encountered. Returned pointers remain valid
+         * during cache lifetime
+         * @param p_color_table GIF color table
+         * @param p_palette receive palette derived from color table
+         * @param p_pairing receive pairing of palette
+         */
+        inline
+        void get( const std::vector<lib_bmp::my_color> & p_color_table
+                , const std::vector<lib_bmp::my_color> * & p_palette
+                , const palette_pairing * & p_pairing
+                );
+
+        inline
+        unsigned int get_nb_hits() const;
+
+        inline
+        unsigned int get_nb_misses() const;
+
+        /**
+         * Compute FNV-1a hash of color table content
+         * @param p_color_table GIF color table
+         * @return hash value
+         */
+        inline static
+        uint64_t hash(const std::vector<lib_bmp::my_color> & p_color_table);
+
+      private:
+        std::function<palette_pairing(const std::vector<lib_bmp::my_color> &, std::vector<lib_bmp::my_color> &)> m_compute;
+
+        /**
+         * Color tables, palettes and pairings indexed by color table hash.
+         * Color table is kept to detect hash collisions
+         */
+        std::multimap<uint64_t, std::tuple<std::vector<lib_bmp::my_color>, std::vector<lib_bmp::my_color>, palette_pairing>> m_entries;
+
+        unsigned int m_nb_hits;
+        unsigned int m_nb_misses;
+    };
+
+    //-------------------------------------------------------------------------
+    palette_pairing_cache::palette_pairing_cache(std::function<palette_pairing(const std::vector<lib_bmp::my_color> &, std::vector<lib_bmp::my_color> &)> p_compute)
+    : m_compute(p_compute)
+    , m_nb_hits(0)
+    , m_nb_misses(0)
+    {
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    palette_pairing_cache::get( const std::vector<lib_bmp::my_color> & p_color_table
+                              , const std::vector<lib_bmp::my_color> * & p_palette
+                              , const palette_pairing * & p_pairing
+                              )
+    {
+        uint64_t l_hash = hash(p_color_table);
+        auto l_range = m_entries.equal_range(l_hash);
+        for(auto l_iter = l_range.first; l_iter != l_range.second; ++l_iter)
+        {
+            if(std::get<0>(l_iter->second) == p_color_table)
+            {
+                ++m_nb_hits;
+                p_palette = & std::get<1>(l_iter->second);
+                p_pairing = & std::get<2>(l_iter->second);
+                return;
+            }
+        }
+        ++m_nb_misses;
+        std::vector<lib_bmp::my_color> l_palette;
+        palette_pairing l_pairing = m_compute(p_color_table, l_palette);
+        auto l_iter = m_entries.emplace(l_hash, std::make_tuple(p_color_table, l_palette, l_pairing));
+        p_palette = & std::get<1>(l_iter->second);
+        p_pairing = & std::get<2>(l_iter->second);
+    }
+
+    //-------------------------------------------------------------------------
+    unsigned int
+    palette_pairing_cache::get_nb_hits() const
+    {
+        return m_nb_hits;
+    }
+
+    //-------------------------------------------------------------------------
+    unsigned int
+    palette_pairing_cache::get_nb_misses() const
+    {
+        return m_nb_misses;
+    }
+
+    //-------------------------------------------------------------------------
+    uint64_t
+    palette_pairing_cache::hash(const std::vector<lib_bmp::my_color> & p_color_table)
+    {
+        uint64_t l_hash = 0xcbf29ce484222325ULL;
+        auto l_add = [&](uint8_t p_byte)
+        {
+            l_hash ^= p_byte;
+            l_hash *= 0x100000001b3ULL;
+        };
+        l_add((uint8_t)p_color_table.size());
+        for(const auto & l_color: p_color_table)
+        {
+            l_add(l_color.get_red());
+            l_add(l_color.get_green());
+            l_add(l_color.get_blue());
+        }
+        return l_hash;
+    }
+
+}
+#endif //STEGANOGIF_PALETTE_PAIRING_CACHE_H
+// EOF
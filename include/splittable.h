@@ -20,10 +20,13 @@
 #define STEGANOGIF_SPLITTABLE_H
 
 #include "countable_item.h"
+#include "flat_histogram.h"
 
 #include <set>
 #include <map>
+#include <memory>
 #include <limits>
+#include <cassert>
 
 namespace steganogif
 {
@@ -38,6 +41,10 @@ namespace steganogif
                   , const splittable<T> & p_splittable2
                   );
 
+    /**
+     * Range of consecutive items of a histogram shared by all splittables
+     * derived from it, so that splitting only computes two index ranges
+     */
     template<typename T>
     class splittable
     {
@@ -62,7 +69,7 @@ namespace steganogif
         unsigned int get_nb() const;
 
         inline
-        void add_item(const countable_item<T> & p_item);
+        unsigned int get_nb_items() const;
 
         inline
         bool is_splittable() const;
@@ -91,15 +98,43 @@ namespace steganogif
         inline
         T get_average() const;
 
+        /**
+         * Range made of first item
+         */
         inline
-        void remove(const countable_item<T> & p_value);
+        splittable<T>
+        first_item() const;
+
+        /**
+         * Range made of last item
+         */
+        inline
+        splittable<T>
+        last_item() const;
 
         inline
         splittable<T>
         remove_extrema() const;
 
       private:
-        std::set<countable_item<T>> m_items;
+
+        inline
+        splittable( const std::shared_ptr<const flat_histogram<T>> & p_histogram
+                  , unsigned int p_begin
+                  , unsigned int p_end
+                  );
+
+        std::shared_ptr<const flat_histogram<T>> m_histogram;
+
+        /**
+         * Index of first item of range in histogram
+         */
+        unsigned int m_begin;
+
+        /**
+         * Index following last item of range in histogram
+         */
+        unsigned int m_end;
         unsigned int m_nb;
     }
     ;
@@ -107,41 +142,37 @@ namespace steganogif
     //------------------------------------------------------------------------------
     template<typename T>
     splittable<T>::splittable(const std::set<countable_item<T>> & p_items)
-    : m_items(p_items)
-    , m_nb(0)
+    : splittable(std::make_shared<const flat_histogram<T>>(p_items), 0, p_items.size())
     {
-        for(auto l_iter: p_items)
-        {
-            m_nb += l_iter.get_nb();
-        }
     }
 
     //------------------------------------------------------------------------------
     template<typename T>
     splittable<T>::splittable(const std::map<T, unsigned int> & p_items)
-    : m_nb(0)
+    : splittable(std::make_shared<const flat_histogram<T>>(p_items), 0, p_items.size())
     {
-        for(auto l_iter: p_items)
-        {
-            m_items.insert(countable_item(l_iter.first, l_iter.second));
-            m_nb += l_iter.second;
-        }
-
     }
 
     //------------------------------------------------------------------------------
     template<typename T>
     splittable<T>::splittable()
-    : m_nb(0)
+    : m_begin(0)
+    , m_end(0)
+    , m_nb(0)
     {
     }
 
     //------------------------------------------------------------------------------
     template<typename T>
-    void splittable<T>::add_item(const countable_item<T> & p_item)
+    splittable<T>::splittable( const std::shared_ptr<const flat_histogram<T>> & p_histogram
+                             , unsigned int p_begin
+                             , unsigned int p_end
+                             )
+    : m_histogram(p_histogram)
+    , m_begin(p_begin)
+    , m_end(p_end)
+    , m_nb(p_histogram->get_nb(p_begin, p_end))
     {
-        m_items.insert(p_item);
-        m_nb += p_item.get_nb();
     }
 
     //------------------------------------------------------------------------------
@@ -151,11 +182,18 @@ namespace steganogif
         return m_nb;
     }
 
+    //------------------------------------------------------------------------------
+    template<typename T>
+    unsigned int splittable<T>::get_nb_items() const
+    {
+        return m_end - m_begin;
+    }
+
     //------------------------------------------------------------------------------
     template<typename T>
     bool splittable<T>::is_splittable() const
     {
-        return m_items.size() > 1;
+        return get_nb_items() > 1;
     }
 
     //------------------------------------------------------------------------------
@@ -163,22 +201,8 @@ namespace steganogif
     std::pair<splittable<T>, splittable<T>> splittable<T>::split() const
     {
         assert(is_splittable());
-        splittable l_splittable1;
-        splittable l_splittable2;
-        splittable * l_target = & l_splittable1;
-        for(auto l_iter: m_items)
-        {
-            if(!l_splittable2.get_nb())
-            {
-                size_t l_nb2 = m_nb - l_splittable1.get_nb();
-                if(std::abs((int)(2 * (l_splittable1.get_nb() + l_iter.get_nb()) - m_nb)) > std::abs((int)(l_splittable1.get_nb() - l_nb2)))
-                {
-                    l_target = & l_splittable2;
-                }
-            }
-            l_target->add_item(l_iter);
-        }
-        return std::make_pair(l_splittable1, l_splittable2);
+        unsigned int l_split_index = m_histogram->get_split_index(m_begin, m_end);
+        return std::make_pair(splittable(m_histogram, m_begin, l_split_index), splittable(m_histogram, l_split_index, m_end));
     }
 
     //------------------------------------------------------------------------------
@@ -193,7 +217,7 @@ namespace steganogif
         }
         else
         {
-            return p_splittable1.m_items.size() < p_splittable2.m_items.size();
+            return p_splittable1.get_nb_items() < p_splittable2.get_nb_items();
         }
     }
 
@@ -202,9 +226,9 @@ namespace steganogif
     std::ostream & operator<<(std::ostream & p_stream, const splittable<T> & p_splittable)
     {
         p_stream << "Nb = " << p_splittable.m_nb << " {";
-        for(auto l_iter: p_splittable.m_items)
+        for(unsigned int l_index = p_splittable.m_begin; l_index < p_splittable.m_end; ++l_index)
         {
-            p_stream << "{" << l_iter << "} ";
+            p_stream << "{" << p_splittable.m_histogram->get_item(l_index) << "} ";
         }
         p_stream << "}";
         return p_stream;
@@ -215,8 +239,7 @@ namespace steganogif
     T
     splittable<T>::get_first_value() const
     {
-        assert(m_items.size());
-        return m_items.begin()->get_value();
+        return get_first().get_value();
     }
 
     //-------------------------------------------------------------------------
@@ -224,8 +247,7 @@ namespace steganogif
     T
     splittable<T>::get_last_value() const
     {
-        assert(m_items.size());
-        return m_items.rbegin()->get_value();
+        return get_last().get_value();
     }
 
     //-------------------------------------------------------------------------
@@ -233,14 +255,7 @@ namespace steganogif
     bool
     splittable<T>::contains(const T & p_value) const
     {
-        for(auto l_iter: m_items)
-        {
-            if(p_value == l_iter.get_value())
-            {
-                return true;
-            }
-        }
-        return false;
+        return get_nb_items() && m_histogram->find(m_begin, m_end, p_value) != m_end;
     }
 
     //-------------------------------------------------------------------------
@@ -249,13 +264,14 @@ namespace steganogif
     splittable<T>::get_most_frequent() const
     {
         unsigned int l_max_count = std::numeric_limits<unsigned int>::min();
-        T l_value;
-        for(auto l_iter: m_items)
+        T l_value{};
+        for(unsigned int l_index = m_begin; l_index < m_end; ++l_index)
         {
-            if(l_iter.get_nb() > l_max_count)
+            const countable_item<T> & l_item = m_histogram->get_item(l_index);
+            if(l_item.get_nb() > l_max_count)
             {
-                l_max_count = l_iter.get_nb();
-                l_value = l_iter.get_value();
+                l_max_count = l_item.get_nb();
+                l_value = l_item.get_value();
             }
         }
         return l_value;
@@ -266,23 +282,26 @@ namespace steganogif
     T
     splittable<T>::get_average() const
     {
-        unsigned int l_total = 0;
-        unsigned int l_total_nb = 0;
-        for(auto l_iter: m_items)
-        {
-            l_total += l_iter.get_value() * l_iter.get_nb();
-            l_total_nb += l_iter.get_nb();
-        }
-        return l_total / l_total_nb;
+        assert(m_nb);
+        return (T)(m_histogram->get_weighted_sum(m_begin, m_end) / (int64_t)m_nb);
     }
 
     //-------------------------------------------------------------------------
-    template <typename T>
-    void
-    splittable<T>::remove(const countable_item<T> & p_value)
+    template<typename T>
+    splittable<T>
+    splittable<T>::first_item() const
+    {
+        assert(get_nb_items());
+        return splittable<T>(m_histogram, m_begin, m_begin + 1);
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename T>
+    splittable<T>
+    splittable<T>::last_item() const
     {
-        m_nb -= p_value.get_nb();
-        m_items.erase(p_value);
+        assert(get_nb_items());
+        return splittable<T>(m_histogram, m_end - 1, m_end);
     }
 
     //-------------------------------------------------------------------------
@@ -290,10 +309,8 @@ namespace steganogif
     splittable<T>
     splittable<T>::remove_extrema() const
     {
-        splittable<T> l_result{m_items};
-        l_result.remove(*m_items.begin());
-        l_result.remove(*m_items.rbegin());
-        return l_result;
+        assert(get_nb_items() > 1);
+        return splittable<T>(m_histogram, m_begin + 1, m_end - 1);
     }
 
     //-------------------------------------------------------------------------
@@ -301,7 +318,8 @@ namespace steganogif
     const countable_item<T> &
     splittable<T>::get_first() const
     {
-        return *m_items.begin();
+        assert(get_nb_items());
+        return m_histogram->get_item(m_begin);
     }
 
 
@@ -310,7 +328,8 @@ namespace steganogif
     const countable_item<T> &
     splittable<T>::get_last() const
     {
-        return *m_items.rbegin();
+        assert(get_nb_items());
+        return m_histogram->get_item(m_end - 1);
     }
 
 }
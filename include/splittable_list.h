@@ -20,9 +20,16 @@
 #define STEGANOGIF_SPLITTABLE_LIST_H
 
 #include "splittable.h"
-#include <tuple>
+#include <utility>
 #include <vector>
 #include <algorithm>
+#ifdef STEGANOGIF_SELF_TEST
+#include <random>
+#include <chrono>
+#include <iostream>
+#include <type_traits>
+#include <cstdlib>
+#endif // STEGANOGIF_SELF_TEST
 
 namespace steganogif
 {
@@ -48,53 +55,315 @@ namespace steganogif
         inline
         std::vector<splittable<T>> to_vector();
 
+        /**
+         * Number of ranges split at their median since construction, for
+         * profiling purpose
+         */
+        inline
+        unsigned int get_nb_splits() const;
+
+#ifdef STEGANOGIF_SELF_TEST
+        /**
+         * Reference implementation of split keeping ranges as lists of
+         * items: range to split and split point are searched by linear
+         * scans, ranges with same number of occurrences and items being
+         * split in order of creation
+         * @param p_items histogram
+         * @param p_number expected number of ranges
+         * @return first and last values of ranges sorted by value
+         */
+        inline static
+        std::vector<std::pair<T, T>> split_reference( const std::map<T, unsigned int> & p_items
+                                                    , unsigned int p_number
+                                                    );
+
+        /**
+         * Generate random histogram
+         * @param p_generator random generator
+         * @param p_ties if true numbers of occurrences are small so that
+         * many of them are equal
+         * @return histogram
+         */
+        inline static
+        std::map<T, unsigned int> generate_items( std::mt19937 & p_generator
+                                                , bool p_ties
+                                                );
+
+        /**
+         * Check that split gives same ranges as reference implementation on
+         * random histograms and compare their execution time
+         * @return true if results are identical
+         */
+        inline static
+        bool self_test();
+#endif // STEGANOGIF_SELF_TEST
+
       private:
-        std::multiset<splittable<T>> m_splittables;
+
+        /**
+         * Heap order of handles: range with most occurrences first, ties
+         * being resolved in favour of oldest handle
+         */
+        inline
+        bool is_lower( unsigned int p_handle1
+                     , unsigned int p_handle2
+                     ) const;
+
+        /**
+         * Ranges of histogram. Index of a range is a stable handle as
+         * splitting a range replaces it by its first half and appends
+         * second one
+         */
+        std::vector<splittable<T>> m_splittables;
+
+        /**
+         * Handles of ranges that can be split, kept as a max heap
+         * according to their number of occurrences
+         */
+        std::vector<unsigned int> m_heap;
+
+        unsigned int m_nb_splits;
     };
 
     //------------------------------------------------------------------------------
     template<typename T>
     splittable_list<T>::splittable_list(const splittable<T> & p_splittable)
+    : m_nb_splits(0)
     {
-        m_splittables.insert(p_splittable);
+        m_splittables.push_back(p_splittable);
+        if(p_splittable.is_splittable())
+        {
+            m_heap.push_back(0);
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    template<typename T>
+    bool splittable_list<T>::is_lower( unsigned int p_handle1
+                                     , unsigned int p_handle2
+                                     ) const
+    {
+        const splittable<T> & l_splittable1 = m_splittables[p_handle1];
+        const splittable<T> & l_splittable2 = m_splittables[p_handle2];
+        if(l_splittable1 < l_splittable2)
+        {
+            return true;
+        }
+        return !(l_splittable2 < l_splittable1) && p_handle1 > p_handle2;
     }
 
     //------------------------------------------------------------------------------
     template<typename T>
     void splittable_list<T>::split(unsigned int p_number)
     {
-        if(1 == m_splittables.size())
+        auto l_is_lower = [this](unsigned int p_handle1, unsigned int p_handle2)
         {
-            splittable<T> l_first;
-            l_first.add_item(m_splittables.begin()->get_first());
-            splittable<T> l_last;
-            l_last.add_item(m_splittables.begin()->get_last());
-            splittable<T> l_intermediate = m_splittables.begin()->remove_extrema();
+            return is_lower(p_handle1, p_handle2);
+        };
+        auto l_add = [&](splittable<T> && p_splittable)
+        {
+            m_splittables.push_back(std::move(p_splittable));
+            if(m_splittables.back().is_splittable())
+            {
+                m_heap.push_back(m_splittables.size() - 1);
+                std::push_heap(m_heap.begin(), m_heap.end(), l_is_lower);
+            }
+        };
+
+        if(1 == m_splittables.size() && m_splittables.front().get_nb_items() > 1)
+        {
+            splittable<T> l_whole = std::move(m_splittables.front());
             m_splittables.clear();
-            m_splittables.insert(l_first);
-            m_splittables.insert(l_intermediate);
-            m_splittables.insert(l_last);
+            m_heap.clear();
+            l_add(l_whole.first_item());
+            if(l_whole.get_nb_items() > 2)
+            {
+                l_add(l_whole.remove_extrema());
+            }
+            l_add(l_whole.last_item());
         }
-        while(m_splittables.size() < p_number)
+
+        // Largest range is split until expected number is reached. Halves
+        // are moved to their slots so handles of other ranges are kept
+        m_splittables.reserve(p_number);
+        while(!m_heap.empty() && m_splittables.size() < p_number)
         {
-            auto l_iter = m_splittables.rbegin();
-            for(; l_iter != m_splittables.rend() && !l_iter->is_splittable(); ++l_iter)
+            std::pop_heap(m_heap.begin(), m_heap.end(), l_is_lower);
+            unsigned int l_handle = m_heap.back();
+            m_heap.pop_back();
+            std::pair<splittable<T>, splittable<T>> l_halves = m_splittables[l_handle].split();
+            ++m_nb_splits;
+            m_splittables[l_handle] = std::move(l_halves.first);
+            if(m_splittables[l_handle].is_splittable())
             {
+                m_heap.push_back(l_handle);
+                std::push_heap(m_heap.begin(), m_heap.end(), l_is_lower);
             }
-            if(l_iter->is_splittable())
+            l_add(std::move(l_halves.second));
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    template<typename T>
+    unsigned int splittable_list<T>::get_nb_splits() const
+    {
+        return m_nb_splits;
+    }
+
+#ifdef STEGANOGIF_SELF_TEST
+    //------------------------------------------------------------------------------
+    template<typename T>
+    std::vector<std::pair<T, T>>
+    splittable_list<T>::split_reference( const std::map<T, unsigned int> & p_items
+                                       , unsigned int p_number
+                                       )
+    {
+        typedef std::vector<std::pair<T, unsigned int>> range_t;
+        auto l_nb = [](const range_t & p_range)
+        {
+            uint64_t l_total = 0;
+            for(const auto & l_item: p_range)
             {
-                splittable<T> l_items1, l_items2;
-                std::tie(l_items1, l_items2) = l_iter->split();
-                m_splittables.erase(*l_iter);
-                m_splittables.insert(l_items1);
-                m_splittables.insert(l_items2);
+                l_total += l_item.second;
             }
-            else
+            return l_total;
+        };
+
+        // First and last items are put apart
+        range_t l_all_items(p_items.begin(), p_items.end());
+        std::vector<range_t> l_ranges;
+        if(l_all_items.size() > 1)
+        {
+            l_ranges.emplace_back(l_all_items.begin(), l_all_items.begin() + 1);
+            if(l_all_items.size() > 2)
+            {
+                l_ranges.emplace_back(l_all_items.begin() + 1, l_all_items.end() - 1);
+            }
+            l_ranges.emplace_back(l_all_items.end() - 1, l_all_items.end());
+        }
+        else
+        {
+            l_ranges.push_back(l_all_items);
+        }
+
+        while(l_ranges.size() < p_number)
+        {
+            // Range with most occurrences then most items, first created
+            // one in case of tie
+            unsigned int l_selected = l_ranges.size();
+            for(unsigned int l_index = 0; l_index < l_ranges.size(); ++l_index)
+            {
+                if(l_ranges[l_index].size() < 2)
+                {
+                    continue;
+                }
+                if(l_ranges.size() == l_selected
+                   || l_nb(l_ranges[l_index]) > l_nb(l_ranges[l_selected])
+                   || (l_nb(l_ranges[l_index]) == l_nb(l_ranges[l_selected]) && l_ranges[l_index].size() > l_ranges[l_selected].size())
+                  )
+                {
+                    l_selected = l_index;
+                }
+            }
+            if(l_ranges.size() == l_selected)
             {
                 break;
             }
+
+            // Split point giving most balanced parts, the one giving the
+            // biggest first part in case of tie
+            range_t & l_range = l_ranges[l_selected];
+            int64_t l_total = l_nb(l_range);
+            int64_t l_first_part = 0;
+            unsigned int l_split_index = 1;
+            int64_t l_min_imbalance = std::numeric_limits<int64_t>::max();
+            for(unsigned int l_index = 1; l_index < l_range.size(); ++l_index)
+            {
+                l_first_part += l_range[l_index - 1].second;
+                int64_t l_imbalance = std::abs(2 * l_first_part - l_total);
+                if(l_imbalance <= l_min_imbalance)
+                {
+                    l_min_imbalance = l_imbalance;
+                    l_split_index = l_index;
+                }
+            }
+            range_t l_second_part(l_range.begin() + l_split_index, l_range.end());
+            l_range.resize(l_split_index);
+            l_ranges.push_back(l_second_part);
+        }
+
+        std::vector<std::pair<T, T>> l_bounds;
+        for(const auto & l_range: l_ranges)
+        {
+            if(!l_range.empty())
+            {
+                l_bounds.emplace_back(l_range.front().first, l_range.back().first);
+            }
+        }
+        std::sort(l_bounds.begin(), l_bounds.end());
+        return l_bounds;
+    }
+
+    //------------------------------------------------------------------------------
+    template<typename T>
+    std::map<T, unsigned int>
+    splittable_list<T>::generate_items( std::mt19937 & p_generator
+                                      , bool p_ties
+                                      )
+    {
+        std::map<T, unsigned int> l_items;
+        unsigned int l_nb_items = 1 + p_generator() % 80;
+        for(unsigned int l_index = 0; l_index < l_nb_items; ++l_index)
+        {
+            T l_value = std::is_signed<T>::value ? (T)((int)(p_generator() % 512) - 256) : (T)(p_generator() % 256);
+            l_items[l_value] = 1 + p_generator() % (p_ties ? 4 : 1000000);
+        }
+        return l_items;
+    }
+
+    //------------------------------------------------------------------------------
+    template<typename T>
+    bool splittable_list<T>::self_test()
+    {
+        std::mt19937 l_generator{0};
+        bool l_success = true;
+        for(bool l_ties: {false, true})
+        {
+            std::chrono::steady_clock::duration l_reference_duration{0};
+            std::chrono::steady_clock::duration l_duration{0};
+            unsigned int l_nb_errors = 0;
+            for(unsigned int l_test = 0; l_test < 2000; ++l_test)
+            {
+                std::map<T, unsigned int> l_items = generate_items(l_generator, l_ties);
+                unsigned int l_number = 1 + l_generator() % 40;
+                auto l_start = std::chrono::steady_clock::now();
+                std::vector<std::pair<T, T>> l_reference = split_reference(l_items, l_number);
+                auto l_middle = std::chrono::steady_clock::now();
+                splittable_list<T> l_list{splittable<T>(l_items)};
+                l_list.split(l_number);
+                std::vector<splittable<T>> l_splittables = l_list.to_vector();
+                auto l_end = std::chrono::steady_clock::now();
+                l_reference_duration += l_middle - l_start;
+                l_duration += l_end - l_middle;
+                std::vector<std::pair<T, T>> l_result;
+                for(const auto & l_splittable: l_splittables)
+                {
+                    l_result.emplace_back(l_splittable.get_first_value(), l_splittable.get_last_value());
+                }
+                if(l_reference != l_result)
+                {
+                    ++l_nb_errors;
+                }
+            }
+            l_success &= !l_nb_errors;
+            std::cout << "Split of " << sizeof(T) << " bytes values" << (l_ties ? " with ties" : "");
+            std::cout << " : reference " << std::chrono::duration_cast<std::chrono::microseconds>(l_reference_duration).count() << "us";
+            std::cout << ", heap " << std::chrono::duration_cast<std::chrono::microseconds>(l_duration).count() << "us";
+            std::cout << " => " << (l_nb_errors ? "KO" : "OK") << std::endl;
         }
+        return l_success;
     }
+#endif // STEGANOGIF_SELF_TEST
 
     //------------------------------------------------------------------------------
     template<typename T>
@@ -20,6 +20,8 @@
 
 #include "splittable_list.h"
 #include <vector>
+#include <algorithm>
+#include <type_traits>
 #if __cplusplus >= 201703L
 #if (!defined(MACX))
 #include <optional>
@@ -44,6 +46,11 @@ namespace steganogif
         std::ostream & operator<< <>(std::ostream & p_stream, const splitted_list & p_splitted_list);
 
       public:
+        /**
+         * Constructor
+         * @param p_list ranges resulting of split, a value belonging to at
+         * most one range
+         */
         inline
         splitted_list(const std::vector<splittable<T>> & p_list);
 
@@ -67,11 +74,45 @@ namespace steganogif
         inline
         T get_average(const T & p_value) const;
 
+#ifdef STEGANOGIF_SELF_TEST
+        /**
+         * Check lookups on random histograms against a linear search
+         * among ranges computed by reference split implementation
+         * @return true if results are identical
+         */
+        inline static
+        bool self_test();
+#endif // STEGANOGIF_SELF_TEST
+
       private:
 
+        /**
+         * Search range containing a value from first values of ranges
+         * @param p_value value to search
+         * @return index of range, -1 if no range contains value
+         */
+        inline
+        int search_index(const T & p_value) const;
+
+        /**
+         * Values on 8 bits are looked up in a table having an entry per
+         * possible value
+         */
+        static constexpr bool m_dense = std::is_integral<T>::value && 1 == sizeof(T);
+
         std::vector<splittable<T>> m_list;
         std::vector<T> m_most_frequents;
         std::vector<T> m_average;
+
+        /**
+         * First value of each range, ranges being sorted by value
+         */
+        std::vector<T> m_first_values;
+
+        /**
+         * Range index for each 8 bits value, -1 if no range contains it
+         */
+        std::vector<int16_t> m_dense_indexes;
     };
 
     //-------------------------------------------------------------------------
@@ -79,7 +120,41 @@ namespace steganogif
     splitted_list<T>::splitted_list(const std::vector<splittable<T>> & p_list)
     : m_list{p_list}
     {
+        std::sort( m_list.begin()
+                 , m_list.end()
+                 , [](const splittable<T> & p_1, const splittable<T> & p_2)
+                   {
+                       return p_1.get_first_value() < p_2.get_first_value();
+                   }
+                 );
+        m_first_values.reserve(m_list.size());
+        for(const auto & l_iter: m_list)
+        {
+            m_first_values.emplace_back(l_iter.get_first_value());
+        }
+        if(m_dense)
+        {
+            m_dense_indexes.resize(256);
+            for(unsigned int l_value = 0; l_value < 256; ++l_value)
+            {
+                m_dense_indexes[l_value] = search_index((T)l_value);
+            }
+        }
+    }
 
+    //-------------------------------------------------------------------------
+    template<typename T>
+    int
+    splitted_list<T>::search_index(const T & p_value) const
+    {
+        // Last range whose first value is not greater than searched one
+        auto l_iter = std::upper_bound(m_first_values.begin(), m_first_values.end(), p_value);
+        if(l_iter == m_first_values.begin())
+        {
+            return -1;
+        }
+        unsigned int l_index = l_iter - m_first_values.begin() - 1;
+        return m_list[l_index].contains(p_value) ? (int)l_index : -1;
     }
 
     //-------------------------------------------------------------------------
@@ -91,14 +166,12 @@ std::experimental::optional<unsigned int>
 #endif // (!defined(MACX))
     splitted_list<T>::get_index(const T & p_value) const
     {
-        for(unsigned int l_index = 0; l_index < m_list.size(); ++l_index)
+        int l_index = m_dense ? m_dense_indexes[(uint8_t)p_value] : search_index(p_value);
+        if(l_index < 0)
         {
-            if(m_list[l_index].contains(p_value))
-            {
-                return l_index;
-            }
+            return {};
         }
-        return {};
+        return (unsigned int)l_index;
     }
 
     //-------------------------------------------------------------------------
@@ -171,6 +244,72 @@ std::experimental::optional<unsigned int>
         throw quicky_exception::quicky_logic_exception("Value " + l_stream.str() + " not found for average", __LINE__, __FILE__);
     }
 
+#ifdef STEGANOGIF_SELF_TEST
+    //-------------------------------------------------------------------------
+    template<typename T>
+    bool
+    splitted_list<T>::self_test()
+    {
+        std::mt19937 l_generator{1};
+        unsigned int l_nb_errors = 0;
+        int l_min_value = std::is_signed<T>::value ? -300 : 0;
+        int l_max_value = std::is_signed<T>::value ? 300 : 255;
+        for(unsigned int l_test = 0; l_test < 2000; ++l_test)
+        {
+            std::map<T, unsigned int> l_items = splittable_list<T>::generate_items(l_generator, l_test % 2);
+            unsigned int l_number = 1 + l_generator() % 40;
+            std::vector<std::pair<T, T>> l_bounds = splittable_list<T>::split_reference(l_items, l_number);
+            splittable_list<T> l_list{splittable<T>(l_items)};
+            l_list.split(l_number);
+            splitted_list<T> l_splitted_list{l_list.to_vector()};
+            l_splitted_list.compute_most_frequent();
+            for(int l_value = l_min_value; l_value <= l_max_value; ++l_value)
+            {
+                // Linear search of range containing value
+                T l_searched = (T)l_value;
+                int l_reference_index = -1;
+                if(l_items.count(l_searched))
+                {
+                    for(unsigned int l_index = 0; l_index < l_bounds.size(); ++l_index)
+                    {
+                        if(l_bounds[l_index].first <= l_searched && l_searched <= l_bounds[l_index].second)
+                        {
+                            l_reference_index = l_index;
+                        }
+                    }
+                }
+                auto l_index = l_splitted_list.get_index(l_searched);
+                if((l_reference_index < 0) != !l_index || (l_index && l_index.value() != (unsigned int)l_reference_index))
+                {
+                    ++l_nb_errors;
+                    continue;
+                }
+                if(l_index)
+                {
+                    // First item with most occurrences in range
+                    const std::pair<T, T> & l_range = l_bounds[l_reference_index];
+                    unsigned int l_max_count = 0;
+                    T l_most_frequent{};
+                    for(auto l_iter = l_items.lower_bound(l_range.first); l_iter != l_items.upper_bound(l_range.second); ++l_iter)
+                    {
+                        if(l_iter->second > l_max_count)
+                        {
+                            l_max_count = l_iter->second;
+                            l_most_frequent = l_iter->first;
+                        }
+                    }
+                    if(l_splitted_list.get_most_frequent(l_searched) != l_most_frequent)
+                    {
+                        ++l_nb_errors;
+                    }
+                }
+            }
+        }
+        std::cout << "Lookup of " << sizeof(T) << " bytes values => " << (l_nb_errors ? "KO" : "OK") << std::endl;
+        return !l_nb_errors;
+    }
+#endif // STEGANOGIF_SELF_TEST
+
     //------------------------------------------------------------------------------
     template<typename T>
     std::ostream & operator<<(std::ostream & p_stream, const splitted_list<T> & p_splitted_list)
@@ -28,18 +28,91 @@ namespace steganogif
     class stegano_header
     {
       public:
+        /**
+         * Version where one pseudo random generator is shared by all frames
+         */
+        static constexpr uint32_t m_sequential_version = 0;
+
+        /**
+         * Version where position and swap bit of each data bit are given
+         * by a keyed permutation computed from password, frame index and
+         * bit index. Version number is followed by a magic and a tag
+         * derived from password so that a wrong password is detected on
+         * header bytes, then by GIF geometry and number of frames so that
+         * mismatching files are rejected before decoding them
+         */
+        static constexpr uint32_t m_keyed_permutation_version = 1;
+
+        static constexpr uint32_t m_current_version = m_keyed_permutation_version;
+
+        /**
+         * Size in byte of digest following data hidden in each frame since
+         * keyed permutation version, so that frames holding a byte range
+         * can be checked without decoding the others
+         */
+        static constexpr unsigned int m_frame_digest_size = sizeof(uint32_t);
+
+        /**
+         * Maximum size in byte of encoded header whatever its version
+         */
+        static constexpr unsigned int m_max_encoded_size = 36;
+
+        /**
+         * Constructor
+         * @param p_content_size size of content hidden in GIF
+         * @param p_password_tag tag derived from password
+         * @param p_width width of GIF pictures
+         * @param p_height height of GIF pictures
+         * @param p_nb_frames number of frames holding header, content and
+         * its SHA1
+         * @param p_version header version
+         */
+        inline
+        stegano_header( uint64_t p_content_size
+                      , uint32_t p_password_tag
+                      , uint32_t p_width
+                      , uint32_t p_height
+                      , uint32_t p_nb_frames
+                      , uint32_t p_version = m_current_version
+                      );
+
+        /**
+         * Decode header located at beginning of content
+         * throw an exception in case of undecodable content or if password
+         * tag differs from expected one
+         * @param p_content content starting by encoded header
+         * @param p_password_tag expected tag derived from password
+         */
+        inline
+        stegano_header( const std::vector<uint8_t> & p_content
+                      , uint32_t p_password_tag
+                      );
+
+        /**
+         * Return size of content hidden in GIF
+         * @return content size in byte
+         */
+        inline
+        uint64_t get_size() const;
+
+        inline
+        uint32_t get_version() const;
+
         inline
-        stegano_header(uint32_t p_content_size);
+        uint32_t get_width() const;
 
         inline
-        stegano_header(std::vector<uint8_t> & p_content);
+        uint32_t get_height() const;
+
+        inline
+        uint32_t get_nb_frames() const;
 
         /**
          * Return size of header in byte once encoded
          * @return encoded size
          */
         inline
-        unsigned int get_size() const;
+        unsigned int get_encoded_size() const;
 
         /**
          * Encode header content in a vector of byte
@@ -51,47 +124,129 @@ namespace steganogif
       private:
 
         /**
-         * Encode 32 bits value and push back produced result to p_content
+         * Encode value and push back produced result to p_content
          * @param p_value value to encode
          * @param p_content receive encoded value
          */
         inline static
-        void encode_and_add( uint32_t p_value
+        void encode_and_add( uint64_t p_value
                            , std::vector<uint8_t> & p_content
                            );
 
         /**
-         * Decode value and remove it from content
-         * throw and exception in case of undecodable content
+         * Decode value located at cursor position and move cursor after it
+         * throw and exception in case of undecodable content or if value
+         * does not fit in p_nb_bits bits
          * @param p_content content
+         * @param p_position cursor position in content
+         * @param p_nb_bits maximum number of bits of value
          * @return decoded value
          */
         inline static
-        uint32_t decode_and_remove(std::vector<uint8_t> & p_content);
+        uint64_t decode_and_advance( const std::vector<uint8_t> & p_content
+                                   , size_t & p_position
+                                   , unsigned int p_nb_bits = 32
+                                   );
+
+        /**
+         * Value following version number since keyed permutation version
+         * to reject content decoded with wrong permutation
+         */
+        static constexpr uint32_t m_magic = 0x53474946;
 
         /**
          * Version number
          */
-        uint32_t m_version = 0;
+        uint32_t m_version;
 
         /**
          * Size of content hidden in GIF
          */
-        uint32_t m_content_size;
+        uint64_t m_content_size;
+
+        /**
+         * Tag derived from password, encoded since keyed permutation
+         * version
+         */
+        uint32_t m_password_tag;
+
+        /**
+         * GIF geometry and number of frames, encoded since keyed
+         * permutation version
+         */
+        uint32_t m_width;
+        uint32_t m_height;
+        uint32_t m_nb_frames;
+
+        /**
+         * Size in byte of encoded header
+         */
+        unsigned int m_encoded_size;
     };
 
     //-------------------------------------------------------------------------
-    stegano_header::stegano_header(uint32_t p_content_size)
-    : m_content_size(p_content_size)
+    stegano_header::stegano_header( uint64_t p_content_size
+                                  , uint32_t p_password_tag
+                                  , uint32_t p_width
+                                  , uint32_t p_height
+                                  , uint32_t p_nb_frames
+                                  , uint32_t p_version
+                                  )
+    : m_version(p_version)
+    , m_content_size(p_content_size)
+    , m_password_tag(p_password_tag)
+    , m_width(p_width)
+    , m_height(p_height)
+    , m_nb_frames(p_nb_frames)
+    , m_encoded_size(0)
+    {
+        if(p_version > m_current_version)
+        {
+            throw quicky_exception::quicky_logic_exception("Bad header version", __LINE__, __FILE__);
+        }
+        m_encoded_size = encode().size();
+    }
+
+    //-------------------------------------------------------------------------
+    uint64_t
+    stegano_header::get_size() const
+    {
+        return m_content_size;
+    }
+
+    //-------------------------------------------------------------------------
+    uint32_t
+    stegano_header::get_version() const
+    {
+        return m_version;
+    }
+
+    //-------------------------------------------------------------------------
+    uint32_t
+    stegano_header::get_width() const
+    {
+        return m_width;
+    }
+
+    //-------------------------------------------------------------------------
+    uint32_t
+    stegano_header::get_height() const
     {
+        return m_height;
+    }
 
+    //-------------------------------------------------------------------------
+    uint32_t
+    stegano_header::get_nb_frames() const
+    {
+        return m_nb_frames;
     }
 
     //-------------------------------------------------------------------------
     unsigned int
-    stegano_header::get_size() const
+    stegano_header::get_encoded_size() const
     {
-        return m_content_size;
+        return m_encoded_size;
     }
 
     //-------------------------------------------------------------------------
@@ -100,12 +255,20 @@ namespace steganogif
     {
         std::vector<uint8_t> l_content;
         encode_and_add(m_version, l_content);
+        if(m_version >= m_keyed_permutation_version)
+        {
+            encode_and_add(m_magic, l_content);
+            encode_and_add(m_password_tag, l_content);
+            encode_and_add(m_width, l_content);
+            encode_and_add(m_height, l_content);
+            encode_and_add(m_nb_frames, l_content);
+        }
         encode_and_add(m_content_size, l_content);
         return l_content;
     }
 
     void
-    stegano_header::encode_and_add(uint32_t p_value,
+    stegano_header::encode_and_add(uint64_t p_value,
                                    std::vector<uint8_t> & p_content
                                   )
     {
@@ -122,20 +285,28 @@ namespace steganogif
     }
 
     //-------------------------------------------------------------------------
-    uint32_t
-    stegano_header::decode_and_remove(std::vector<uint8_t> & p_content)
+    uint64_t
+    stegano_header::decode_and_advance( const std::vector<uint8_t> & p_content
+                                      , size_t & p_position
+                                      , unsigned int p_nb_bits
+                                      )
     {
-        uint32_t l_result = 0;
-        uint32_t l_shift = 0;
-        while(p_content.size())
+        uint64_t l_result = 0;
+        unsigned int l_shift = 0;
+        while(p_position < p_content.size())
         {
-            uint32_t l_byte = p_content[0];
-            p_content.erase(p_content.begin());
+            uint64_t l_byte = p_content[p_position];
+            ++p_position;
+            // Last 7 bits group may only be partially used
+            if(p_nb_bits - l_shift < 7 && (l_byte & 0x7F) >> (p_nb_bits - l_shift))
+            {
+                throw quicky_exception::quicky_logic_exception("Bad encoded value: too big", __LINE__, __FILE__);
+            }
             l_result |= (l_byte & 0x7F) << l_shift;
             if(l_byte & 0x80)
             {
                 l_shift += 7;
-                if(l_shift > 28)
+                if(l_shift >= p_nb_bits)
                 {
                     throw quicky_exception::quicky_logic_exception("Bad encoded value: too big", __LINE__, __FILE__);
                 }
@@ -149,14 +320,39 @@ namespace steganogif
     }
 
     //-------------------------------------------------------------------------
-    stegano_header::stegano_header(std::vector<uint8_t> & p_content)
-    : m_version(decode_and_remove(p_content))
-    , m_content_size(decode_and_remove(p_content))
+    stegano_header::stegano_header( const std::vector<uint8_t> & p_content
+                                  , uint32_t p_password_tag
+                                  )
+    : m_version(0)
+    , m_content_size(0)
+    , m_password_tag(p_password_tag)
+    , m_width(0)
+    , m_height(0)
+    , m_nb_frames(0)
+    , m_encoded_size(0)
     {
-        if(0 != m_version)
+        size_t l_position = 0;
+        m_version = decode_and_advance(p_content, l_position);
+        if(m_version > m_current_version)
         {
             throw quicky_exception::quicky_logic_exception("Bad header version", __LINE__, __FILE__);
         }
+        if(m_version >= m_keyed_permutation_version)
+        {
+            if(m_magic != decode_and_advance(p_content, l_position))
+            {
+                throw quicky_exception::quicky_logic_exception("Bad header magic", __LINE__, __FILE__);
+            }
+            if(m_password_tag != decode_and_advance(p_content, l_position))
+            {
+                throw quicky_exception::quicky_logic_exception("Bad header password tag", __LINE__, __FILE__);
+            }
+            m_width = decode_and_advance(p_content, l_position);
+            m_height = decode_and_advance(p_content, l_position);
+            m_nb_frames = decode_and_advance(p_content, l_position);
+        }
+        m_content_size = decode_and_advance(p_content, l_position, 64);
+        m_encoded_size = l_position;
     }
 
 }
@@ -22,22 +22,42 @@
 #include "sha1.h"
 #include "my_bmp.h"
 #include "yuv_color.h"
+#include "yuv_kernels.h"
 #include "splittable_list.h"
 #include "splitted_list.h"
+#include "color_statistics.h"
 #include "stegano_header.h"
-#include "gif_streamer.h"
-#include "gif.h"
-#include "gif_graphic_block.h"
+#include "content_reader.h"
+#include "content_writer.h"
+#include "incremental_sha1.h"
+#include "worker_pool.h"
+#include "bounded_queue.h"
+#include "keyed_permutation.h"
+#include "palette_pairing.h"
+#include "palette_pairing_cache.h"
+#include "indexed_picture.h"
+#include "grid_quantizer.h"
+#include "median_cut_quantizer.h"
+#include "indexed_gif_streamer.h"
+#include "gif_stream_reader.h"
+#include "mapped_file.h"
 #include <string>
+#include <array>
 #include <chrono>
 #include <random>
 #include <set>
 #include <algorithm>
+#include <numeric>
+#include <limits>
 #include <tuple>
 #include <cmath>
 #include <map>
 #include <sstream>
+#include <deque>
+#include <thread>
 #include <fstream>
+#include <memory>
+#include <cstring>
 
 #if __has_include(<filesystem>)
 #include <filesystem>
@@ -48,48 +68,91 @@ namespace steganogif
     class steganogif
     {
       public:
+        /**
+         * Algorithm used to reduce colors of truecolor pictures
+         */
+        enum class quantizer_type
+        {
+            /// Fixed 128 colors palette
+            grid,
+            /// 128 colors palette adapted to picture
+            median_cut
+        };
+
+        /**
+         * Constructor
+         * @param p_password password used to hide/extract content
+         * @param p_dump_bmp debug mode where each encoded/decoded frame is dumped as BMP file
+         */
         inline
-        steganogif(const std::string & p_password);
+        steganogif( const std::string & p_password
+                  , bool p_dump_bmp = false
+                  );
 
         inline
         ~steganogif();
 
+        /**
+         * Hide content in GIF file
+         * @param p_output_file_name GIF file
+         * @param p_content_file_name file to hide
+         * @param p_transport_file_name BMP file used as picture
+         * @param p_quantizer algorithm reducing colors of BMP file when it
+         * has more than 256 colors
+         */
         inline
         void encode( const std::string & p_output_file_name
                    , const std::string & p_content_file_name
                    , const std::string & p_transport_file_name
+                   , quantizer_type p_quantizer = quantizer_type::grid
                    );
 
+        /**
+         * Extract content hidden in GIF file
+         * @param p_input_file_name GIF file
+         * @param p_content_file_name file receiving extracted content
+         * @param p_range_start offset of first content byte to extract
+         * @param p_range_end offset following last content byte to
+         * extract. When range does not cover the whole content only frames
+         * holding it are decoded, each of them being checked against its
+         * digest. Frames of sequential version have no digest so they are
+         * decoded up to SHA1 following content to check it
+         */
         inline
         void decode( const std::string & p_input_file_name
                    , const std::string & p_content_file_name
+                   , uint64_t p_range_start = 0
+                   , uint64_t p_range_end = std::numeric_limits<uint64_t>::max()
                    );
 
+#ifdef STEGANOGIF_SELF_TEST
+        /**
+         * Check that color correspondance computation and color component
+         * splitting give same results as reference brute force
+         * implementations and compare their execution time
+         * @return true if results are identical
+         */
+        inline static
+        bool self_test();
+#endif // STEGANOGIF_SELF_TEST
+
       private:
 
         inline
         lib_bmp::my_bmp
         compute_simplified_bmp(const lib_bmp::my_bmp & p_bmp);
 
-        /**
-         * Convert parameter BMP file to a BMP file with only 128 colors
-         * @param p_bmp BMP content to be converted
-         * @return converted BMP content
-         */
-        inline
-        lib_bmp::my_bmp
-        compute_128_color_bmp(const lib_bmp::my_bmp & p_bmp);
-
         /**
          * Transform 128 color palette in 256 color palette
-         * @param p_bmp BMP content whose palette should be extended
+         * @param p_picture picture whose palette should be extended
          */
         inline
         void
-        extend_palette(lib_bmp::my_bmp & p_bmp);
+        extend_palette(indexed_picture & p_picture);
 
         /**
          * Compute correspondancy between reference color and coding color
+         * Closest colors are paired first, ties being broken by color order
          * @param p_colors list of colors
          * @return correspondancy table
          */
@@ -97,78 +160,116 @@ namespace steganogif
         std::map<lib_bmp::my_color, lib_bmp::my_color>
         compute_color_correspondance(const std::set<lib_bmp::my_color> & p_colors);
 
+#ifdef STEGANOGIF_SELF_TEST
+        /**
+         * Reference brute force implementation of color correspondance
+         * computation searching closest colors among all remaining ones
+         * @param p_colors list of colors
+         * @return correspondancy table
+         */
+        inline static
+        std::map<lib_bmp::my_color, lib_bmp::my_color>
+        compute_color_correspondance_reference(const std::set<lib_bmp::my_color> & p_colors);
+#endif // STEGANOGIF_SELF_TEST
+
         /**
-         * Compute color correspondance and apply GIF palette to BMP file
+         * Compute color correspondance of GIF color table completed to 256
+         * colors
          * @param p_colors GIF color table
-         * @param p_bmp BMP content
+         * @param p_palette receive color table completed with black colors
          * @return color correspondance
          */
         inline static
         std::map<lib_bmp::my_color, lib_bmp::my_color>
-        compute_color_correspondance( const lib_gif::gif_color_table & p_colors
-                                    , lib_bmp::my_bmp & p_bmp
+        compute_color_correspondance( const std::vector<lib_bmp::my_color> & p_colors
+                                    , std::vector<lib_bmp::my_color> & p_palette
                                     );
 
         /**
-         * Encode data in a pixel information
-         * @param p_x pixel coordinate on X axis
-         * @param p_y pixel coordinate on Y axis
-         * @param p_data bit to encode
-         * @param p_swap indicate if swap should be apply between reference and coding color
-         * @param p_color_correspondance color correspondance
-         * @param p_bmp BMP content where data is encoded
+         * Compute digest of data hidden in a frame so that frame can be
+         * checked without decoding the other ones
+         * @param p_frame_index frame index
+         * @param p_data data hidden in frame, digest excluded
+         * @param p_size data size in byte
+         * @return first 32 bits of SHA1 of frame index followed by data
          */
-        inline
-        void
-        encode_pixel( unsigned int p_x
-                    , unsigned int p_y
-                    , bool p_data
-                    , bool p_swap
-                    , const std::map<lib_bmp::my_color, lib_bmp::my_color> & p_color_correspondance
-                    , lib_bmp::my_bmp & p_bmp
-                    );
+        inline static
+        uint32_t compute_frame_digest( uint32_t p_frame_index
+                                     , const uint8_t * p_data
+                                     , size_t p_size
+                                     );
 
         /**
-         * Retrieve data encoded in pixel information
-         * @param p_x pixel coordinate on X axis
-         * @param p_y pixel coordinate on Y axis
-         * @param p_swap indicate if swap should be apply between reference and coding color
-         * @param p_color_correspondance color correspondance
-         * @param p_bmp BMP content where data is encoded
-         * @return encoded data
+         * Collect palette colors of BMP content
+         * @param p_bmp BMP content
+         * @return palette colors
          */
-        inline
-        bool
-        decode_pixel( unsigned int p_x
-                    , unsigned int p_y
-                    , bool p_swap
-                    , const std::map<lib_bmp::my_color, lib_bmp::my_color> & p_color_correspondance
-                    , lib_bmp::my_bmp & p_bmp
-                    );
+        inline static
+        std::vector<lib_bmp::my_color> get_palette_colors(const lib_bmp::my_bmp & p_bmp);
 
         /**
-         * Generate list of pixels coordinate
-         * @return list of pixels coordinate
+         * Generate list of pixels as linear offsets in picture, offset type
+         * can be reduced to 16 bits when number of pixels permits it
+         * @param p_nb_pixels number of pixels of picture
+         * @return list of pixels offsets
          */
+        template <typename OFFSET_TYPE>
         inline static
-        std::vector<std::pair<unsigned int, unsigned int>> generate_pixel_list(const lib_bmp::my_bmp & );
+        std::vector<OFFSET_TYPE> generate_pixel_list(uint32_t p_nb_pixels);
 
 
-        inline
-        void encode_picture( lib_bmp::my_bmp & p_bmp
+        /**
+         * Encode a chunk of data in picture
+         * @param p_picture picture where data is encoded
+         * @param p_content data to encode, pixels remaining after its end receive random bits
+         * @param p_permutation permutation giving pixel and swap bit of each data bit
+         * @param p_pairing color correspondance expressed with palette indexes
+         * @param p_data_generator pseudo random generator providing bits after end of data
+         */
+        inline static
+        void encode_picture( indexed_picture & p_picture
+                           , const std::vector<uint8_t> & p_content
+                           , const keyed_permutation & p_permutation
+                           , const palette_pairing & p_pairing
+                           , std::mt19937 & p_data_generator
+                           );
+
+        /**
+         * Extract data from picture encoded with a keyed permutation
+         * @param p_picture picture where data is encoded
+         * @param p_content receive extracted data
+         * @param p_permutation permutation giving pixel and swap bit of each data bit
+         * @param p_pairing color correspondance expressed with palette indexes
+         * @param p_nb_bytes maximum number of bytes to extract, only pixels
+         * of these bytes are read
+         */
+        inline static
+        void decode_picture( const indexed_picture & p_picture
                            , std::vector<uint8_t> & p_content
-                           , std::vector<std::pair<unsigned int, unsigned int>> & p_pixels
-                           , const std::map<lib_bmp::my_color, lib_bmp::my_color> & p_color_correspondance
-                           , std::mt19937 & p_generator
-                           , const uint64_t & p_offset
+                           , const keyed_permutation & p_permutation
+                           , const palette_pairing & p_pairing
+                           , unsigned int p_nb_bytes = std::numeric_limits<unsigned int>::max()
                            );
 
-        inline
-        void decode_picture( lib_bmp::my_bmp & p_bmp
+        /**
+         * Extract data from picture encoded with shuffled pixel list used
+         * by sequential version
+         * @param p_picture picture where data is encoded
+         * @param p_content receive extracted data
+         * @param p_pixels list of pixels offsets shuffled along decoding
+         * @param p_pairing color correspondance expressed with palette indexes
+         * @param p_generator pseudo random generator derived from password
+         * @param p_nb_bytes maximum number of bytes to extract, list is
+         * only shuffled for pixels of these bytes
+         */
+        template <typename OFFSET_TYPE>
+        inline static
+        void decode_picture( const indexed_picture & p_picture
                            , std::vector<uint8_t> & p_content
-                           , std::vector<std::pair<unsigned int, unsigned int>> & p_pixels
-                           , const std::map<lib_bmp::my_color, lib_bmp::my_color> & p_color_correspondance
+                           , std::vector<OFFSET_TYPE> & p_pixels
+                           , const palette_pairing & p_pairing
                            , std::mt19937 & p_generator
+                           , unsigned int p_nb_bytes = std::numeric_limits<unsigned int>::max()
                            );
 
         inline
@@ -191,14 +292,6 @@ namespace steganogif
                                  , const std::map<int, unsigned int> & p_v_colors
                                  );
 
-        /**
-         * Convert GIF color to BMP color
-         * @param p_color GIF color
-         * @return BMP color
-         */
-        inline static
-        lib_bmp::my_color to_bmp_color(const lib_gif::gif_color & p_color);
-
         /**
          * Compute geometric distance between 2 colors
          * @param p_color1
@@ -221,23 +314,57 @@ namespace steganogif
                   , const yuv_color & p_color2
                   );
 
+        /**
+         * Compute square of geometric distance between 2 colors
+         * @param p_color1
+         * @param p_color2
+         * @return squared distance
+         */
+        inline static
+        uint32_t square_dist( const lib_bmp::my_color & p_color1
+                            , const lib_bmp::my_color & p_color2
+                            );
+
         std::seed_seq * m_seed;
+
+        /**
+         * Password hash
+         */
+        std::array<uint32_t, 5> m_keys;
+
+        /**
+         * Tag stored in header to check password, computed from a hash
+         * distinct from m_keys
+         */
+        uint32_t m_password_tag;
+
+        /**
+         * Indicate if frames should be dumped as BMP files for debug purpose
+         */
+        bool m_dump_bmp;
     };
 
     //-------------------------------------------------------------------------
-    steganogif::steganogif(const std::string & p_password)
+    steganogif::steganogif( const std::string & p_password
+                          , bool p_dump_bmp
+                          )
     : m_seed(nullptr)
+    , m_password_tag(0)
+    , m_dump_bmp(p_dump_bmp)
     {
         sha1 l_sha1{(const uint8_t*)p_password.data(), p_password.size()};
 
+        for(unsigned int l_index = 0; l_index < m_keys.size(); ++l_index)
+        {
+            m_keys[l_index] = l_sha1.get_key(l_index);
+        }
+
         // Generate seed from password hash
-        m_seed = new std::seed_seq({ l_sha1.get_key(0)
-                                   , l_sha1.get_key(1)
-                                   , l_sha1.get_key(2)
-                                   , l_sha1.get_key(3)
-                                   , l_sha1.get_key(4)
-                                   }
-                                  );
+        m_seed = new std::seed_seq(m_keys.begin(), m_keys.end());
+
+        std::string l_tag_input{"steganogif password tag:" + p_password};
+        sha1 l_tag_sha1{(const uint8_t*)l_tag_input.data(), l_tag_input.size()};
+        m_password_tag = l_tag_sha1.get_key(0);
     }
 
     //-------------------------------------------------------------------------
@@ -251,6 +378,7 @@ namespace steganogif
     steganogif::encode( const std::string & p_output_file_name
                       , const std::string & p_content_file_name
                       , const std::string & p_transport_file_name
+                      , quantizer_type p_quantizer
                       )
     {
         uint64_t l_content_size = 0;
@@ -275,11 +403,6 @@ namespace steganogif
 #endif // __has_include(<filesystem>)
 
         std::cout << "Content size : " << 8 * l_content_size << " bits" << std::endl;
-        stegano_header l_header(l_content_size);
-        std::vector<uint8_t> l_content{l_header.encode()};
-        uint64_t l_header_size = l_content.size();
-        l_content.resize(l_header_size + l_content_size + 20);
-        std::cout << "Header + content size : " << 8 * l_content.size() << " bits" << std::endl;
 
         // BMP file
         lib_bmp::my_bmp l_bmp(p_transport_file_name);
@@ -288,72 +411,90 @@ namespace steganogif
         {
             throw quicky_exception::quicky_logic_exception("Number of pixels in picture should be a multiple of 8", __LINE__, __FILE__);
         }
-
-        unsigned int l_frame_number = 8 * l_content.size() / l_bits_per_picture;
-        if(l_frame_number * l_bits_per_picture < 8 * l_content.size())
+        // Data hidden in each frame is followed by its digest
+        if(l_bits_per_picture / 8 <= stegano_header::m_frame_digest_size)
         {
-            ++ l_frame_number;
+            throw quicky_exception::quicky_logic_exception("Picture is too small to hold header in first frame", __LINE__, __FILE__);
         }
+        unsigned int l_chunk_size = l_bits_per_picture / 8 - stegano_header::m_frame_digest_size;
+
+        // Number of frames is part of header so its encoded size is
+        // increased until it matches number of frames needed for header,
+        // content and SHA1
+        stegano_header l_header(l_content_size, m_password_tag, l_bmp.get_width(), l_bmp.get_height(), 0);
+        unsigned int l_frame_number = 0;
+        for(;;)
+        {
+            uint64_t l_data_size = l_header.get_encoded_size() + l_content_size + 5 * sizeof(uint32_t);
+            uint64_t l_nb_frames = (l_data_size + l_chunk_size - 1) / l_chunk_size;
+            if(l_nb_frames > std::numeric_limits<uint32_t>::max())
+            {
+                throw quicky_exception::quicky_logic_exception("Content would need " + std::to_string(l_nb_frames) + " frames which is more than header can declare", __LINE__, __FILE__);
+            }
+            l_frame_number = l_nb_frames;
+            if(l_frame_number == l_header.get_nb_frames())
+            {
+                break;
+            }
+            l_header = stegano_header(l_content_size, m_password_tag, l_bmp.get_width(), l_bmp.get_height(), l_frame_number);
+        }
+        if(l_header.get_encoded_size() > l_chunk_size)
+        {
+            throw quicky_exception::quicky_logic_exception("Picture is too small to hold header in first frame", __LINE__, __FILE__);
+        }
+        content_reader l_content_reader{p_content_file_name, l_content_size, l_header.encode()};
+        std::cout << "Header + content size : " << 8 * l_content_reader.get_size() << " bits" << std::endl;
         std::cout << "Content size per picture : " << l_bits_per_picture << " bits" << std::endl;
         std::cout << "Number of picture : " << l_frame_number << std::endl;
 
-        lib_bmp::my_bmp * l_work_bmp = &l_bmp;
-
+        // Frames are encoded on palette indexes of reference picture
+        indexed_picture l_reference_picture{l_bmp.get_width(), l_bmp.get_height()};
+        std::vector<lib_bmp::my_color> l_palette_colors;
         if(l_bmp.get_nb_bits_per_pixel() > 8)
         {
             std::cout << "Reduce number of colors" << std::endl;
-            l_work_bmp = new lib_bmp::my_bmp(compute_128_color_bmp(l_bmp));
+            l_reference_picture = quantizer_type::median_cut == p_quantizer ? median_cut_quantizer::quantize(l_bmp) : grid_quantizer::quantize(l_bmp);
 
-            extend_palette(*l_work_bmp);
-            l_work_bmp->save("simplified.bmp");
+            extend_palette(l_reference_picture);
+            if(m_dump_bmp)
+            {
+                l_reference_picture.to_bmp().save("simplified.bmp");
+            }
+            for(unsigned int l_index = 0; l_index < 256; ++l_index)
+            {
+                l_palette_colors.emplace_back(l_reference_picture.get_color(l_index));
+            }
+        }
+        else
+        {
+            l_reference_picture = indexed_picture(l_bmp);
+            l_palette_colors = get_palette_colors(l_bmp);
         }
 
         // Check there are no duplicated colors in palette
         std::set<lib_bmp::my_color> l_colors;
         {
             std::map<lib_bmp::my_color, unsigned int> l_colors_index;
-            for (unsigned int l_index = 0; l_index < l_work_bmp->get_palette().get_size(); ++l_index)
+            for (unsigned int l_index = 0; l_index < l_palette_colors.size(); ++l_index)
             {
-                //std::cout << l_bmp_256.get_palette().get_color(l_index) << std::endl;
-                if (l_colors_index.count(l_work_bmp->get_palette().get_color(l_index)))
+                if (l_colors_index.count(l_palette_colors[l_index]))
                 {
                     std::stringstream l_color_stream;
-                    l_color_stream << l_work_bmp->get_palette().get_color(l_index);
-                    throw quicky_exception::quicky_logic_exception( "Color duplicated at index " + std::to_string(l_index) + " / " + std::to_string(l_colors_index.find(l_work_bmp->get_palette().get_color(l_index))->second) + " : " + l_color_stream.str(), __LINE__, __FILE__);
+                    l_color_stream << l_palette_colors[l_index];
+                    throw quicky_exception::quicky_logic_exception( "Color duplicated at index " + std::to_string(l_index) + " / " + std::to_string(l_colors_index.find(l_palette_colors[l_index])->second) + " : " + l_color_stream.str(), __LINE__, __FILE__);
                 }
-                l_colors_index.insert(std::make_pair(l_work_bmp->get_palette().get_color(l_index), l_index));
-                l_colors.insert(l_work_bmp->get_palette().get_color(l_index));
+                l_colors_index.insert(std::make_pair(l_palette_colors[l_index], l_index));
+                l_colors.insert(l_palette_colors[l_index]);
             }
         }
 
         std::cout << "Compute color correspondances " << std::endl;
         std::map<lib_bmp::my_color, lib_bmp::my_color> l_color_correspondance = compute_color_correspondance(l_colors);
 
-        // Read file content
-        {
-            std::cout << "Read content to hide" << std::endl;
-            std::ifstream l_content_file;
-            l_content_file.open(p_content_file_name, std::ifstream::binary);
-            if (l_content_file.is_open())
-            {
-                l_content_file.read((char*)l_content.data() + l_header_size, l_content_size);
-                l_content_file.close();
-                std::cout << "Compute hash" << std::endl;
-                sha1 l_content_sha1(l_content.data() + l_header_size, l_content_size);
-                for(unsigned int l_index = 0; l_index < 5; ++l_index)
-                {
-                    auto * l_ptr = (uint32_t*)&l_content[l_content.size() - 5 * sizeof(uint32_t)+ l_index * sizeof(uint32_t)];
-                    * l_ptr = l_content_sha1.get_key(l_index);
-                }
-            } else
-            {
-                throw quicky_exception::quicky_runtime_exception( R"(Unable to find file ")" + p_content_file_name + R"(")", __LINE__, __FILE__);
-            }
-        }
-
-        std::vector<std::pair<unsigned int, unsigned int>> l_pixels = generate_pixel_list(*l_work_bmp);
-        uint64_t l_offset = 0;
-        std::mt19937 l_generator{*m_seed};
+        // Reference palette is reordered to store color pairs at adjacent indexes
+        std::vector<lib_bmp::my_color> l_palette = palette_pairing::compute_adjacent_palette(l_palette_colors, l_color_correspondance);
+        l_reference_picture.reorder_palette(l_palette);
+        palette_pairing l_pairing{l_palette, l_color_correspondance};
 
         std::ofstream l_output_gif;
         l_output_gif.open(p_output_file_name, std::ofstream::binary);
@@ -362,42 +503,128 @@ namespace steganogif
             throw quicky_exception::quicky_runtime_exception(R"(Unable to create file ")" + p_output_file_name + R"(")", __LINE__, __FILE__);
         }
 
-        gif_streamer::gif_streamer l_gif_streamer{l_output_gif, l_work_bmp->get_width(), l_work_bmp->get_height()};
+        indexed_gif_streamer l_gif_streamer{l_output_gif, l_reference_picture.get_width(), l_reference_picture.get_height()};
+
+        // Each frame has its own generators so frames are encoded in
+        // parallel. Content of next frames is read while workers encode
+        // previous ones, workers report encoded slots through a queue and
+        // frames are written in order. Number of slots bounds memory used,
+        // their pictures being allocated when first used
+        unsigned int l_nb_slots = std::min(2 * std::max(1u, std::thread::hardware_concurrency()), l_frame_number);
+        std::vector<std::vector<uint8_t>> l_contents(l_nb_slots);
+        std::vector<indexed_picture> l_pictures(l_nb_slots, indexed_picture(0, 0));
+        std::vector<bool> l_encoded_slots(l_nb_slots, false);
+        bounded_queue<unsigned int> l_encoding_queue{l_nb_slots};
+        std::deque<unsigned int> l_pending_slots;
+        std::vector<unsigned int> l_free_slots(l_nb_slots);
+        std::iota(l_free_slots.begin(), l_free_slots.end(), 0);
+
+        // Random bits after end of data are seeded once per encoding to
+        // keep output independent of number of threads
+        unsigned int l_data_seed = (unsigned int)std::chrono::system_clock::now().time_since_epoch().count();
+
+        auto l_encode_frame = [&](unsigned int p_frame_index, unsigned int p_slot)
+        {
+            indexed_picture & l_picture = l_pictures[p_slot];
+            l_picture = l_reference_picture;
+            keyed_permutation l_permutation{l_bits_per_picture, m_keys, p_frame_index};
+            std::seed_seq l_data_seed_seq{l_data_seed, p_frame_index};
+            std::mt19937 l_data_generator{l_data_seed_seq};
+            std::vector<uint8_t> & l_content = l_contents[p_slot];
+            uint32_t l_digest = compute_frame_digest(p_frame_index, l_content.data(), l_content.size());
+            l_content.insert(l_content.end(), (const uint8_t*)&l_digest, (const uint8_t*)&l_digest + sizeof(uint32_t));
+            encode_picture(l_picture, l_content, l_permutation, l_pairing, l_data_generator);
+            if(m_dump_bmp)
+            {
+                l_picture.to_bmp().save(std::to_string(p_frame_index) + ".bmp");
+            }
+        };
+
+        // Declared after data used by tasks so that pending tasks complete
+        // before those data are destroyed
+        worker_pool l_worker_pool{(l_nb_slots + 1) / 2};
+
+        // Wait for one encoding then write encoded frames whose
+        // predecessors are written
+        auto l_collect_slot = [&]()
+        {
+            l_encoded_slots[l_encoding_queue.pop()] = true;
+            while(!l_pending_slots.empty() && l_encoded_slots[l_pending_slots.front()])
+            {
+                unsigned int l_slot = l_pending_slots.front();
+                l_pending_slots.pop_front();
+                l_encoded_slots[l_slot] = false;
+                if(l_contents[l_slot].empty())
+                {
+                    // Encoding failed, rethrow its exception
+                    l_worker_pool.wait();
+                }
+                l_gif_streamer.send_picture(l_pictures[l_slot]);
+                l_free_slots.push_back(l_slot);
+            }
+        };
+
         for(unsigned int l_frame_index = 0; l_frame_index < l_frame_number; ++l_frame_index)
         {
+            while(l_free_slots.empty())
+            {
+                l_collect_slot();
+            }
+            unsigned int l_slot = l_free_slots.back();
+            l_free_slots.pop_back();
+            l_pending_slots.push_back(l_slot);
             std::cout << "Encode picture " << l_frame_index << std::endl;
-            encode_picture(*l_work_bmp, l_content, l_pixels, l_color_correspondance, l_generator, l_offset);
-            std::string l_bmp_name = std::to_string(l_frame_index) + ".bmp";
-            l_work_bmp->save(l_bmp_name);
-            l_gif_streamer.send_bmp(l_bmp_name);
-            l_offset += l_bits_per_picture / 8;
+            // Content is read and hashed one frame at a time, every frame
+            // receiving at least one byte
+            l_content_reader.read(l_contents[l_slot], l_chunk_size);
+            l_worker_pool.submit([=, &l_encode_frame, &l_contents, &l_encoding_queue]
+                                 {
+                                     try
+                                     {
+                                         l_encode_frame(l_frame_index, l_slot);
+                                     }
+                                     catch(...)
+                                     {
+                                         l_contents[l_slot].clear();
+                                         l_encoding_queue.push(l_slot);
+                                         throw;
+                                     }
+                                     l_encoding_queue.push(l_slot);
+                                 }
+                                );
         }
+        while(!l_pending_slots.empty())
+        {
+            l_collect_slot();
+        }
+        l_worker_pool.wait();
 
         l_gif_streamer.send_trailer();
         l_output_gif.close();
-
-        if(l_work_bmp != &l_bmp)
-        {
-            delete l_work_bmp;
-        }
     }
 
     //-------------------------------------------------------------------------
     void
     steganogif::decode( const std::string & p_input_file_name
                       , const std::string & p_content_file_name
+                      , uint64_t p_range_start
+                      , uint64_t p_range_end
                       )
     {
+        // Frames are read one at a time while decoding, directly from page
+        // cache when file can be mapped
+#ifdef STEGANOGIF_MAPPED_FILE_SUPPORTED
+        mapped_file l_gif_file{p_input_file_name};
+        gif_stream_reader l_gif{l_gif_file.get_data(), l_gif_file.get_size()};
+#else // STEGANOGIF_MAPPED_FILE_SUPPORTED
         std::ifstream l_gif_file;
         l_gif_file.open(p_input_file_name.c_str(), std::ifstream::binary);
         if(!l_gif_file.is_open())
         {
             throw quicky_exception::quicky_runtime_exception(R"(Unable to read file ")" + p_input_file_name + R"(")", __LINE__, __FILE__);
         }
-
-        lib_gif::gif l_gif(l_gif_file);
-
-        l_gif_file.close();
+        gif_stream_reader l_gif{l_gif_file};
+#endif // STEGANOGIF_MAPPED_FILE_SUPPORTED
 
         unsigned int l_bits_per_picture = l_gif.get_height() * l_gif.get_width();
         if(l_bits_per_picture % 8)
@@ -406,215 +633,532 @@ namespace steganogif
         }
         std::cout << "Content size per picture : " << l_bits_per_picture << " bits" << std::endl;
 
-        lib_bmp::my_bmp l_bmp(l_gif.get_width(), l_gif.get_height(), 8);
-
-        // Get global palette from GIF
-        std::map<lib_bmp::my_color, lib_bmp::my_color> l_color_correspondance;
-        lib_gif::gif_color_table const * l_color_table = nullptr;
-        if(l_gif.get_global_color_table_flag())
+        // When a byte range is requested frames are located first so that
+        // those preceding it can be skipped
+        bool l_range_requested = p_range_start || std::numeric_limits<uint64_t>::max() != p_range_end;
+        std::vector<uint64_t> l_frame_positions;
+        std::vector<bool> l_key_frames;
+        if(l_range_requested)
         {
-            l_color_table = & l_gif.get_global_color_table();
+            l_gif.index_frames(l_frame_positions, l_key_frames);
+        }
 
-            l_color_correspondance = compute_color_correspondance(*l_color_table, l_bmp);
+        // Canvas is kept as palette indexes. Its palette is the one of
+        // last composed frame, color table being completed to 256 colors
+        indexed_picture l_picture{l_gif.get_width(), l_gif.get_height()};
+        std::vector<lib_bmp::my_color> l_canvas_palette(256);
+        palette_pairing l_pairing;
 
-            // Set background
-            lib_gif::gif_color l_color = (*l_color_table)[l_gif.get_background_index()];
-            lib_bmp::my_color l_bmp_color = to_bmp_color(l_color);
-            for(unsigned int l_y = 0 ; l_y < l_gif.get_height() ; ++l_y)
+        // Change canvas palette, indexes being converted to new palette
+        // unless they are about to be fully overwritten
+        auto l_use_palette = [&](const std::vector<lib_bmp::my_color> & p_palette, bool p_convert)
+        {
+            if(p_palette == l_canvas_palette)
+            {
+                return;
+            }
+            if(p_convert)
             {
-                for(unsigned int l_x = 0 ; l_x < l_gif.get_width() ; ++l_x)
+                l_picture.reorder_palette(p_palette);
+            }
+            else
+            {
+                for(unsigned int l_index = 0; l_index < p_palette.size(); ++l_index)
                 {
-                    l_bmp.set_pixel_color(l_x,l_y,lib_bmp::my_color_alpha(l_bmp_color));
+                    l_picture.set_color(l_index, p_palette[l_index]);
                 }
             }
+            l_canvas_palette = p_palette;
+        };
+
+        // Color tables are usually identical from one frame to another so
+        // pairing of each distinct color table is computed only once
+        palette_pairing_cache l_pairing_cache{[](const std::vector<lib_bmp::my_color> & p_color_table, std::vector<lib_bmp::my_color> & p_palette)
+                                              {
+                                                  std::map<lib_bmp::my_color, lib_bmp::my_color> l_color_correspondance = compute_color_correspondance(p_color_table, p_palette);
+                                                  return palette_pairing(p_palette, l_color_correspondance);
+                                              }
+                                             };
 
+        // Get global palette from GIF
+        const std::vector<lib_bmp::my_color> * l_global_palette = nullptr;
+        const palette_pairing * l_global_pairing = nullptr;
+        uint8_t l_background_index = 0;
+        if(l_gif.has_global_color_table())
+        {
+            l_pairing_cache.get(l_gif.get_global_color_table(), l_global_palette, l_global_pairing);
+            l_use_palette(*l_global_palette, false);
+
+            // Set background
+            l_background_index = l_gif.get_background_index() % l_gif.get_global_color_table().size();
+            std::fill(l_picture.get_indexes().begin(), l_picture.get_indexes().end(), l_background_index);
         }
 
         unsigned int l_frame_index = 0;
         std::vector<uint8_t> l_content;
         std::mt19937 l_generator{*m_seed};
-        std::vector<std::pair<unsigned int, unsigned int>> l_pixels = generate_pixel_list(l_bmp);
-        unsigned int l_content_size = 0;
+        uint64_t l_content_size = 0;
+
+        // Extracted bytes are streamed to a temporary file as soon as
+        // frames preceding them are done, frames being numbered from 0 to
+        // l_last_frame
+        content_writer l_content_writer{p_content_file_name};
+        uint64_t l_range_end = 0;
+        uint64_t l_header_size = 0;
+        uint64_t l_chunk_size = l_bits_per_picture / 8;
+        uint64_t l_data_end = 0;
+        uint64_t l_last_frame = std::numeric_limits<uint64_t>::max();
+        unsigned int l_seek_frame = 0;
+        uint32_t l_version = stegano_header::m_sequential_version;
+
+        // Pixel list used by sequential version is generated once this
+        // version is probed, with 16 bits offsets when geometry permits it
+        bool l_short_offsets = l_bits_per_picture <= 0x10000;
+        std::vector<uint16_t> l_short_pixels;
+        std::vector<uint32_t> l_pixels;
+
+        // Extract bits of a frame encoded with keyed permutation, whose
+        // decoding does not depend on other frames. Only shared data are
+        // read so it can be called concurrently
+        auto l_extract_frame = [&]( unsigned int p_frame_index
+                                  , const indexed_picture & p_picture
+                                  , const palette_pairing & p_pairing
+                                  , std::vector<uint8_t> & p_content
+                                  )
+        {
+            decode_picture(p_picture, p_content, keyed_permutation(l_bits_per_picture, m_keys, p_frame_index), p_pairing);
+        };
 
-        const lib_gif::gif_graphic_control_extension * l_control_extension = nullptr;
-        for(unsigned int l_index = 0 ; l_index < l_gif.get_nb_data_block(); ++l_index)
+        // Check digest following data hidden in a frame then keep only
+        // data. Only shared data are read so it can be called concurrently
+        auto l_check_frame = [&](unsigned int p_frame_index, std::vector<uint8_t> & p_content)
         {
-            const lib_gif::gif_data_block & l_data_block = l_gif.get_data_block(l_index);
-            switch (l_data_block.get_type())
+            uint64_t l_data_start = (uint64_t)p_frame_index * l_chunk_size;
+            size_t l_size = std::min(l_chunk_size, l_data_end - l_data_start);
+            uint32_t l_digest;
+            std::memcpy(&l_digest, p_content.data() + l_size, sizeof(uint32_t));
+            if(compute_frame_digest(p_frame_index, p_content.data(), l_size) != l_digest)
             {
-                case lib_gif::gif_data_block::t_gif_data_block_type::GRAPHICAL_CONTROL_EXTENSION:
-                    l_control_extension = dynamic_cast<const lib_gif::gif_graphic_control_extension*>(&l_data_block);
-                    break;
-                case lib_gif::gif_data_block::t_gif_data_block_type::COMMENT_EXTENSION:
-                case lib_gif::gif_data_block::t_gif_data_block_type::APPLICATION_EXTENSION:
-                    break;
-                case lib_gif::gif_data_block::t_gif_data_block_type::GRAPHIC_BLOCK:
+                throw quicky_exception::quicky_logic_exception("Content of frame " + std::to_string(p_frame_index) + " does not match its digest", __LINE__, __FILE__);
+            }
+            p_content.resize(l_size);
+        };
+
+        // Extract header bytes of first frame according to header version.
+        // Sequential extraction shuffles pixel list and consumes generator
+        // so it works on copies to leave full decoding unaffected
+        auto l_decode_header_bytes = [&](uint32_t p_version)
+        {
+            unsigned int l_nb_bytes = stegano_header::m_max_encoded_size;
+            if(stegano_header::m_sequential_version != p_version)
+            {
+                decode_picture(l_picture, l_content, keyed_permutation(l_bits_per_picture, m_keys, 0), l_pairing, l_nb_bytes);
+                return;
+            }
+            if(l_short_offsets && l_short_pixels.empty())
+            {
+                l_short_pixels = generate_pixel_list<uint16_t>(l_bits_per_picture);
+            }
+            else if(!l_short_offsets && l_pixels.empty())
+            {
+                l_pixels = generate_pixel_list<uint32_t>(l_bits_per_picture);
+            }
+            std::mt19937 l_header_generator{l_generator};
+            if(l_short_offsets)
+            {
+                std::vector<uint16_t> l_header_pixels{l_short_pixels};
+                decode_picture(l_picture, l_content, l_header_pixels, l_pairing, l_header_generator, l_nb_bytes);
+            }
+            else
+            {
+                std::vector<uint32_t> l_header_pixels{l_pixels};
+                decode_picture(l_picture, l_content, l_header_pixels, l_pairing, l_header_generator, l_nb_bytes);
+            }
+        };
+
+        // Extract bits of current frame according to header version
+        auto l_decode_frame = [&](uint32_t p_version, unsigned int p_frame_index)
+        {
+            if(stegano_header::m_sequential_version != p_version)
+            {
+                l_extract_frame(p_frame_index, l_picture, l_pairing, l_content);
+            }
+            else if(l_short_offsets)
+            {
+                decode_picture(l_picture, l_content, l_short_pixels, l_pairing, l_generator);
+            }
+            else
+            {
+                decode_picture(l_picture, l_content, l_pixels, l_pairing, l_generator);
+            }
+        };
+
+        // Composition is sequential but once frames are independent their
+        // bits are extracted by workers from snapshots of canvas. Workers
+        // report extracted snapshots through a queue and their bytes are
+        // written in frame order. Number of snapshots bounds memory used:
+        // they are created once header gives number of frames left, two
+        // per worker at most, and their pictures are allocated when first
+        // used. Sequential version extracts bits from canvas itself
+        unsigned int l_max_snapshots = 2 * std::max(1u, std::thread::hardware_concurrency());
+        std::vector<indexed_picture> l_snapshots;
+        std::vector<palette_pairing> l_snapshot_pairings;
+        std::vector<std::vector<uint8_t>> l_snapshot_contents;
+        std::vector<uint64_t> l_snapshot_positions;
+        std::vector<bool> l_extracted_snapshots;
+        bounded_queue<unsigned int> l_extraction_queue{l_max_snapshots};
+        std::deque<unsigned int> l_pending_snapshots;
+        std::vector<unsigned int> l_free_snapshots;
+
+        // Declared after data used by tasks so that pending tasks complete
+        // before those data are destroyed. Created along with snapshots
+        std::unique_ptr<worker_pool> l_worker_pool;
+
+        // Wait for one extraction then write bytes of extracted frames
+        // whose predecessors are written
+        auto l_collect_snapshot = [&]()
+        {
+            l_extracted_snapshots[l_extraction_queue.pop()] = true;
+            while(!l_pending_snapshots.empty() && l_extracted_snapshots[l_pending_snapshots.front()])
+            {
+                unsigned int l_snapshot_index = l_pending_snapshots.front();
+                l_pending_snapshots.pop_front();
+                l_extracted_snapshots[l_snapshot_index] = false;
+                if(l_snapshot_contents[l_snapshot_index].empty())
                 {
-                    const lib_gif::gif_graphic_block & l_graphic_block = * dynamic_cast<const lib_gif::gif_graphic_block*>(&l_data_block);
-                    const unsigned int l_left_position = l_graphic_block.get_left_position();
-                    const unsigned int l_top_position = l_graphic_block.get_top_position();
-                    const unsigned int l_width = l_graphic_block.get_width();
-                    const unsigned int l_height = l_graphic_block.get_height();
-
-                    std::string l_error;
-                    if(l_width + l_left_position > l_gif.get_width())
-                    {
-                        l_error = "Max x coordinate " + std::to_string(l_width + l_left_position) + " is greater than width " + std::to_string(l_gif.get_width());
-                    }
-                    if(l_height + l_top_position > l_gif.get_height())
+                    // Extraction failed, rethrow its exception
+                    l_worker_pool->wait();
+                }
+                l_content_writer.write(l_snapshot_positions[l_snapshot_index], l_snapshot_contents[l_snapshot_index].data(), l_snapshot_contents[l_snapshot_index].size());
+                l_free_snapshots.push_back(l_snapshot_index);
+            }
+        };
+
+        gif_frame l_frame;
+        std::vector<uint8_t> l_frame_indexes;
+        while(l_gif.read_frame_header(l_frame))
+        {
+            const unsigned int l_left_position = l_frame.get_left_position();
+            const unsigned int l_top_position = l_frame.get_top_position();
+            const unsigned int l_width = l_frame.get_width();
+            const unsigned int l_height = l_frame.get_height();
+
+            std::string l_error;
+            if(l_width + l_left_position > l_gif.get_width())
+            {
+                l_error = "Max x coordinate " + std::to_string(l_width + l_left_position) + " is greater than width " + std::to_string(l_gif.get_width());
+            }
+            if(l_height + l_top_position > l_gif.get_height())
+            {
+                l_error = "Max y coordinate " + std::to_string(l_height + l_top_position) + " is greater than height " + std::to_string(l_gif.get_height());
+            }
+            if(!l_error.empty())
+            {
+                throw quicky_exception::quicky_logic_exception(l_error,__LINE__,__FILE__);
+            }
+
+            const std::vector<lib_bmp::my_color> * l_frame_palette = l_global_palette;
+            const palette_pairing * l_frame_pairing = l_global_pairing;
+            unsigned int l_nb_colors = l_gif.get_global_color_table().size();
+            if(l_frame.has_local_color_table())
+            {
+                l_pairing_cache.get(l_frame.get_local_color_table(), l_frame_palette, l_frame_pairing);
+                l_nb_colors = l_frame.get_local_color_table().size();
+            }
+            if(!l_nb_colors)
+            {
+                throw quicky_exception::quicky_logic_exception("No colour table available",__LINE__,__FILE__);
+            }
+
+            bool l_transparency = l_frame.has_transparent_color();
+
+            indexed_picture * l_saved_rectangle = nullptr;
+            if(3 == l_frame.get_disposal_method())
+            {
+                l_saved_rectangle = new indexed_picture(l_width, l_height);
+                for(unsigned int l_index = 0; l_index < l_canvas_palette.size(); ++l_index)
+                {
+                    l_saved_rectangle->set_color(l_index, l_canvas_palette[l_index]);
+                }
+                for(unsigned int l_y = 0; l_y < l_height; ++l_y)
+                {
+                    const uint8_t * l_canvas_row = l_picture.get_indexes().data() + (l_top_position + l_y) * l_gif.get_width() + l_left_position;
+                    std::copy(l_canvas_row, l_canvas_row + l_width, l_saved_rectangle->get_indexes().data() + l_y * l_width);
+                }
+            }
+
+            // Compose frame on canvas. Opaque frames are decompressed
+            // directly in canvas, other ones in a buffer whose non
+            // transparent pixels are then copied
+            bool l_full_frame = l_width == l_gif.get_width() && l_height == l_gif.get_height();
+            l_use_palette(*l_frame_palette, l_transparency || !l_full_frame);
+            l_pairing = *l_frame_pairing;
+            uint8_t * l_canvas_origin = l_picture.get_indexes().data() + l_top_position * l_gif.get_width() + l_left_position;
+            if(!l_transparency)
+            {
+                l_gif.read_frame_indexes(l_canvas_origin, l_gif.get_width());
+            }
+            else
+            {
+                l_frame_indexes.assign((size_t)l_width * l_height, l_frame.get_transparent_index());
+                l_gif.read_frame_indexes(l_frame_indexes.data(), l_width);
+            }
+            for(unsigned int l_y = 0; l_y < l_height; ++l_y)
+            {
+                uint8_t * l_canvas_row = l_canvas_origin + l_y * l_gif.get_width();
+                const uint8_t * l_row = l_transparency ? l_frame_indexes.data() + l_y * l_width : l_canvas_row;
+                for(unsigned int l_x = 0; l_x < l_width; ++l_x)
+                {
+                    uint8_t l_index = l_row[l_x];
+                    if(l_transparency && l_frame.get_transparent_index() == l_index)
                     {
-                        l_error = "Max y coordinate " + std::to_string(l_height + l_top_position) + " is greater than height " + std::to_string(l_gif.get_height());
+                        continue;
                     }
-                    if(!l_error.empty())
+                    if(l_index >= l_nb_colors)
                     {
-                        throw quicky_exception::quicky_logic_exception(l_error,__LINE__,__FILE__);
+                        throw quicky_exception::quicky_logic_exception("Color index " + std::to_string(l_index) + " is outside of colour table",__LINE__,__FILE__);
                     }
+                    l_canvas_row[l_x] = l_index;
+                }
+            }
 
-                    lib_bmp::my_bmp * l_saved_rectangle = nullptr;
-                    if(l_control_extension && 3 == l_control_extension->get_disposal_method())
+            std::cout << "Decode picture " << std::to_string(l_frame_index) << std::endl;
+            if(!l_frame_index)
+            {
+                // Header version is not yet known, try most recent one then
+                // sequential one on header bytes only so that a wrong
+                // password is rejected without decoding whole frame
+                uint32_t l_candidate_version = stegano_header::m_current_version;
+                for(;;)
+                {
+                    l_content.clear();
+                    l_decode_header_bytes(l_candidate_version);
+                    try
                     {
-                        l_saved_rectangle = new lib_bmp::my_bmp(l_width, l_height, 8);
-                        for(unsigned int l_y = 0; l_y < l_height; ++l_y)
+                        stegano_header l_header{l_content, m_password_tag};
+                        if(l_header.get_version() != l_candidate_version)
                         {
-                            for(unsigned int l_x = 0; l_x < l_width; ++l_x)
-                            {
-                                l_saved_rectangle->set_pixel_color(l_x, l_y, l_bmp.get_pixel_color(l_x + l_left_position, l_y + l_top_position));
-                            }
+                            throw quicky_exception::quicky_logic_exception("Bad header version", __LINE__, __FILE__);
                         }
+                        l_version = l_candidate_version;
+                        break;
                     }
-
-                    if(l_graphic_block.is_image())
+                    catch(quicky_exception::quicky_logic_exception & e)
                     {
-                        const lib_gif::gif_image & l_image = l_graphic_block.get_image();
-                        lib_gif::gif_color_table const * l_saved_color_table = l_color_table;
-                        if(l_image.get_local_color_table_flag())
+                        if(stegano_header::m_sequential_version == l_candidate_version)
                         {
-                            l_color_table = & l_image.get_local_color_table();
-                            l_color_correspondance = compute_color_correspondance(*l_color_table, l_bmp);
-                        }
-                        if(!l_color_table)
-                        {
-                            throw quicky_exception::quicky_logic_exception("No colour table available",__LINE__,__FILE__);
+                            throw quicky_exception::quicky_logic_exception("No header found, password is wrong or file contains no hidden content", __LINE__, __FILE__);
                         }
+                        l_candidate_version = stegano_header::m_sequential_version;
+                    }
+                }
+                stegano_header l_header{l_content, m_password_tag};
+                l_content_size = l_header.get_size();
+                std::cout << "Header version : " << l_version << std::endl;
+                std::cout << "Content size : " << 8 * l_content_size << " bits" << std::endl;
+                l_header_size = l_header.get_encoded_size();
+                // Data hidden in each frame is followed by its digest since
+                // keyed permutation version
+                if(l_version >= stegano_header::m_keyed_permutation_version)
+                {
+                    l_chunk_size -= stegano_header::m_frame_digest_size;
+                }
+                if(l_header_size > l_chunk_size)
+                {
+                    throw quicky_exception::quicky_logic_exception("Picture is too small to hold header in first frame", __LINE__, __FILE__);
+                }
+                l_data_end = l_header_size + l_content_size + 5 * sizeof(uint32_t);
+                if(l_version >= stegano_header::m_keyed_permutation_version)
+                {
+                    if(l_header.get_width() != l_gif.get_width() || l_header.get_height() != l_gif.get_height())
+                    {
+                        throw quicky_exception::quicky_logic_exception("Content was hidden in " + std::to_string(l_header.get_width()) + "x" + std::to_string(l_header.get_height()) + " pictures whereas GIF pictures are " + std::to_string(l_gif.get_width()) + "x" + std::to_string(l_gif.get_height()), __LINE__, __FILE__);
+                    }
+                    if(l_header.get_nb_frames() != (l_data_end + l_chunk_size - 1) / l_chunk_size)
+                    {
+                        throw quicky_exception::quicky_logic_exception("Header declares " + std::to_string(l_header.get_nb_frames()) + " frames which does not match content size", __LINE__, __FILE__);
+                    }
+                    std::cout << "Number of frames : " << l_header.get_nb_frames() << std::endl;
+                }
 
-                        for(unsigned int l_y = 0 ; l_y < l_height ; ++l_y)
-                        {
-                            unsigned int l_computed_y = !l_image.get_interlace_flag() ? l_y : l_image.deinterlace(l_y);
-                            for(unsigned int l_x = 0 ; l_x < l_width ; ++l_x)
-                            {
-                                if(!l_control_extension || !l_control_extension->get_transparent_color_flag() || l_control_extension->get_transparent_color_index() != l_image.get_color_index(l_x,l_y))
-                                {
-                                    lib_gif::gif_color l_color = (*l_color_table)[l_image.get_color_index(l_x,l_computed_y)];
-                                    lib_bmp::my_color l_bmp_color = to_bmp_color(l_color);
-                                    l_bmp.set_pixel_color(l_left_position + l_x,l_top_position + l_y,lib_bmp::my_color_alpha(l_bmp_color));
-                                }
-                            }
-                        }
-                        std::cout << "Decode picture " << std::to_string(l_frame_index) << std::endl;
-                        decode_picture(l_bmp, l_content, l_pixels, l_color_correspondance, l_generator);
+                l_range_end = std::min<uint64_t>(p_range_end, l_content_size);
+                if(l_range_requested && p_range_start >= l_range_end)
+                {
+                    throw quicky_exception::quicky_logic_exception("Byte range [" + std::to_string(p_range_start) + ", " + std::to_string(p_range_end) + ") is outside of content of size " + std::to_string(l_content_size), __LINE__, __FILE__);
+                }
+                // Byte at content offset N is stored in frame
+                // (header size + N) / data size per frame
+                uint64_t l_first_frame = (l_header_size + p_range_start) / l_chunk_size;
+                uint64_t l_range_last_frame = (l_header_size + l_range_end - 1) / l_chunk_size;
+                // SHA1 following content is checked when range covers it all
+                // or when frames have no digest, in which case they are
+                // decoded up to SHA1
+                bool l_check_sha1 = (!p_range_start && l_range_end == l_content_size) || stegano_header::m_sequential_version == l_version;
+                l_last_frame = l_check_sha1 ? (l_data_end - 1) / l_chunk_size : l_range_last_frame;
+                if(!l_frame_positions.empty() && l_frame_positions.size() <= l_last_frame)
+                {
+                    std::cout << "Insufficient number of frames (" << l_frame_positions.size() << ") regarding number required (" << l_last_frame + 1 << ") according to declared content size" << std::endl;
+                    std::cout << "No content associated with this password" << std::endl;
+                    delete l_saved_rectangle;
+                    return;
+                }
 
-                        if(!l_frame_index)
+                l_content.clear();
+                l_decode_frame(l_version, l_frame_index);
+                if(l_version >= stegano_header::m_keyed_permutation_version)
+                {
+                    l_check_frame(l_frame_index, l_content);
+                }
+                l_content_writer.open(l_content_size, p_range_start, l_range_end, l_check_sha1);
+                l_content_writer.write(0, l_content.data() + l_header_size, l_content.size() - l_header_size);
+                if(l_range_requested)
+                {
+                    // Sequential version shares its generator between all
+                    // frames so none of them can be skipped. Otherwise
+                    // decoding restarts from last key frame before range
+                    if(l_version >= stegano_header::m_keyed_permutation_version)
+                    {
+                        for(unsigned int l_index = std::min<uint64_t>(l_first_frame, l_key_frames.size() - 1); l_index > 1 && !l_seek_frame; --l_index)
                         {
-                            stegano_header l_header{l_content};
-                            l_content_size = l_header.get_size();
-                            std::cout << "Content size : " << 8 * l_content_size << " bits" << std::endl;
+                            l_seek_frame = l_key_frames[l_index] ? l_index : 0;
                         }
-                        l_bmp.save("decoded_" + std::to_string(l_frame_index) + ".bmp");
-                        ++l_frame_index;
-                        l_color_table = l_saved_color_table;
                     }
-                    if(l_control_extension)
+                    std::cout << "Byte range is stored in frames " << l_first_frame << " to " << l_range_last_frame << std::endl;
+                }
+
+                if(l_version >= stegano_header::m_keyed_permutation_version)
+                {
+                    uint64_t l_nb_frames_left = l_last_frame + 1 - std::max(1u, l_seek_frame);
+                    unsigned int l_nb_snapshots = std::min<uint64_t>(l_max_snapshots, l_nb_frames_left);
+                    if(l_nb_snapshots)
                     {
-                        switch(l_control_extension->get_disposal_method())
+                        l_snapshots.resize(l_nb_snapshots, indexed_picture(0, 0));
+                        l_snapshot_pairings.resize(l_nb_snapshots);
+                        l_snapshot_contents.resize(l_nb_snapshots);
+                        l_snapshot_positions.resize(l_nb_snapshots);
+                        l_extracted_snapshots.resize(l_nb_snapshots, false);
+                        l_free_snapshots.resize(l_nb_snapshots);
+                        std::iota(l_free_snapshots.begin(), l_free_snapshots.end(), 0);
+                        l_worker_pool.reset(new worker_pool((l_nb_snapshots + 1) / 2));
+                    }
+                }
+            }
+            else if(l_version >= stegano_header::m_keyed_permutation_version)
+            {
+                while(l_free_snapshots.empty())
+                {
+                    l_collect_snapshot();
+                }
+                unsigned int l_snapshot_index = l_free_snapshots.back();
+                l_free_snapshots.pop_back();
+                l_pending_snapshots.push_back(l_snapshot_index);
+                l_snapshots[l_snapshot_index] = l_picture;
+                l_snapshot_pairings[l_snapshot_index] = l_pairing;
+                l_snapshot_positions[l_snapshot_index] = (uint64_t)l_frame_index * l_chunk_size - l_header_size;
+                unsigned int l_extracted_frame_index = l_frame_index;
+                l_worker_pool->submit([=, &l_extract_frame, &l_snapshots, &l_snapshot_pairings, &l_snapshot_contents, &l_check_frame, &l_extraction_queue]
+                                      {
+                                          std::vector<uint8_t> & l_frame_content = l_snapshot_contents[l_snapshot_index];
+                                          l_frame_content.clear();
+                                          try
+                                          {
+                                              l_extract_frame(l_extracted_frame_index, l_snapshots[l_snapshot_index], l_snapshot_pairings[l_snapshot_index], l_frame_content);
+                                              l_check_frame(l_extracted_frame_index, l_frame_content);
+                                          }
+                                          catch(...)
+                                          {
+                                              l_frame_content.clear();
+                                              l_extraction_queue.push(l_snapshot_index);
+                                              throw;
+                                          }
+                                          l_extraction_queue.push(l_snapshot_index);
+                                      }
+                                     );
+            }
+            else
+            {
+                l_content.clear();
+                l_decode_frame(l_version, l_frame_index);
+                l_content_writer.write((uint64_t)l_frame_index * l_chunk_size - l_header_size, l_content.data(), l_content.size());
+            }
+            if(m_dump_bmp)
+            {
+                l_picture.to_bmp().save("decoded_" + std::to_string(l_frame_index) + ".bmp");
+            }
+            ++l_frame_index;
+
+            switch(l_frame.get_disposal_method())
+            {
+                case 0:
+                case 1:
+                    break;
+                case 2:
+                    if(l_gif.has_global_color_table())
+                    {
+                        l_use_palette(*l_global_palette, true);
+                        for(unsigned int l_y = 0; l_y < l_height; ++l_y)
                         {
-                            case 0:
-                            case 1:
-                                break;
-                            case 2:
-                                if(l_gif.get_global_color_table_flag())
-                                {
-                                    l_color_table = & l_gif.get_global_color_table();
-                                    lib_gif::gif_color l_color = (*l_color_table)[l_gif.get_background_index()];
-                                    lib_bmp::my_color l_bmp_color = to_bmp_color(l_color);
-                                    for(unsigned int l_y = 0; l_y < l_height; ++l_y)
-                                    {
-                                        for(unsigned int l_x = 0; l_x < l_width; ++l_x)
-                                        {
-                                            l_bmp.set_pixel_color(l_x + l_left_position, l_y + l_top_position, lib_bmp::my_color_alpha(l_bmp_color));
-                                        }
-                                    }
-                                }
-                                break;
-                            case 3:
-                            {
-                                for(unsigned int l_y = 0; l_y < l_height; ++l_y)
-                                {
-                                    for(unsigned int l_x = 0; l_x < l_width; ++l_x)
-                                    {
-                                        l_bmp.set_pixel_color(l_x + l_left_position, l_y + l_top_position, l_saved_rectangle->get_pixel_color(l_x, l_y));
-                                    }
-                                }
-                                delete l_saved_rectangle;
-                                l_saved_rectangle = nullptr;
-                            }
-                                break;
-                            default:
-                                std::cout << "Unsupported disposal method : " << l_control_extension->get_disposal_method() << std::endl ;
+                            uint8_t * l_canvas_row = l_picture.get_indexes().data() + (l_top_position + l_y) * l_gif.get_width() + l_left_position;
+                            std::fill(l_canvas_row, l_canvas_row + l_width, l_background_index);
                         }
                     }
-                    l_control_extension = nullptr;
-                }
                     break;
-                case lib_gif::gif_data_block::t_gif_data_block_type::TRAILER:
+                case 3:
+                {
+                    l_saved_rectangle->reorder_palette(l_canvas_palette);
+                    for(unsigned int l_y = 0; l_y < l_height; ++l_y)
+                    {
+                        const uint8_t * l_saved_row = l_saved_rectangle->get_indexes().data() + l_y * l_width;
+                        std::copy(l_saved_row, l_saved_row + l_width, l_picture.get_indexes().data() + (l_top_position + l_y) * l_gif.get_width() + l_left_position);
+                    }
+                    delete l_saved_rectangle;
+                    l_saved_rectangle = nullptr;
+                }
                     break;
                 default:
-                    throw quicky_exception::quicky_logic_exception("Unsupported gif_data_block type "+lib_gif::gif_data_block::type_to_string(l_data_block.get_type()),__LINE__,__FILE__);
-
+                    std::cout << "Unsupported disposal method : " << l_frame.get_disposal_method() << std::endl ;
             }
-        }
 
-        try
-        {
-            // To have number of frame
-            ++l_frame_index;
-            if(l_frame_index * l_bits_per_picture < 8 * l_content.size())
+            if(1 == l_frame_index)
+            {
+                if(l_seek_frame)
+                {
+                    std::cout << "Skip frames 1 to " << l_seek_frame - 1 << std::endl;
+                    l_gif.seek_frame(l_frame_positions[l_seek_frame]);
+                    l_frame_index = l_seek_frame;
+                }
+            }
+            if(l_frame_index > l_last_frame)
             {
-                unsigned int l_expected_frame_number = 8 * l_content_size / l_bits_per_picture + !!((8 * l_content_size) % l_bits_per_picture);
-                throw quicky_exception::quicky_logic_exception("Insufficant number of frame (" + std::to_string(l_frame_index) + " regarding number required ("+ std::to_string(l_expected_frame_number) +") according to declared content size", __LINE__, __FILE__);
+                break;
             }
         }
-        catch(std::exception & e)
+#ifndef STEGANOGIF_MAPPED_FILE_SUPPORTED
+        l_gif_file.close();
+#endif // STEGANOGIF_MAPPED_FILE_SUPPORTED
+        while(!l_pending_snapshots.empty())
         {
-            std::cout << "No content associated with this password" << std::endl;
-            return;
+            l_collect_snapshot();
         }
+        if(l_worker_pool)
+        {
+            l_worker_pool->wait();
+        }
+        std::cout << "Color table pairing cache : " << l_pairing_cache.get_nb_hits() << " hits, " << l_pairing_cache.get_nb_misses() << " misses" << std::endl;
 
-        // Check if content was retrieved
-        if(l_content.size() == l_content_size + 20)
+        if(l_frame_index <= l_last_frame)
         {
+            std::cout << "Insufficient number of frames (" << l_frame_index << ") regarding number required (" << l_last_frame + 1 << ") according to declared content size" << std::endl;
             std::cout << "No content associated with this password" << std::endl;
             return;
         }
-        // Check SHA1
-        sha1 l_sha1(l_content.data(), l_content_size);
-        for(unsigned int l_index = 0; l_index < 5; ++ l_index)
-        {
-            auto l_ptr = (uint32_t*)(l_content.data() + l_content_size + l_index * sizeof(uint32_t));
-            if(l_sha1.get_key(l_index) != *l_ptr)
-            {
-                std::cout << "No content associated with this password" << std::endl;
-                return;
-            }
-        }
 
-        std::ofstream l_content_file;
-        l_content_file.open(p_content_file_name, std::ofstream::binary);
-        if(!l_content_file.is_open())
+        // Content file is only created if SHA1 matches when it is checked
+        if(!l_content_writer.commit())
         {
-            throw quicky_exception::quicky_runtime_exception(R"(Unable to create file ")" + p_content_file_name + R"(")", __LINE__, __FILE__);
+            std::cout << "No content associated with this password" << std::endl;
+            return;
         }
-        l_content_file.write((char*)l_content.data(), l_content_size);
-        l_content_file.close();
         std::cout << R"(Content extracted in ")" << p_content_file_name << R"(")" << std::endl;
     }
 
@@ -643,6 +1187,18 @@ namespace steganogif
         return l_dist;
     }
 
+    //-------------------------------------------------------------------------
+    uint32_t
+    steganogif::square_dist( const lib_bmp::my_color & p_color1
+                           , const lib_bmp::my_color & p_color2
+                           )
+    {
+        int l_red_diff = ((int) p_color1.get_red()) - ((int) p_color2.get_red());
+        int l_green_diff = ((int) p_color1.get_green()) - ((int) p_color2.get_green());
+        int l_blue_diff = ((int) p_color1.get_blue()) - ((int) p_color2.get_blue());
+        return l_red_diff * l_red_diff + l_green_diff * l_green_diff + l_blue_diff * l_blue_diff;
+    }
+
     //-------------------------------------------------------------------------
     std::map<lib_bmp::my_color, lib_bmp::my_color>
     steganogif::compute_simplified_colors(const std::set<lib_bmp::my_color> & p_all_colors,
@@ -665,6 +1221,9 @@ namespace steganogif
         l_list_b.split(6);
         splitted_list<uint8_t> l_splitted_list_b{l_list_b.to_vector()};
         l_splitted_list_b.compute_average();
+#ifdef VERBOSE_STEGANOGIF
+        std::cout << "Splits R/G/B : " << l_list_r.get_nb_splits() << "/" << l_list_g.get_nb_splits() << "/" << l_list_b.get_nb_splits() << std::endl;
+#endif // VERBOSE_STEGANOGIF
 
         std::map<lib_bmp::my_color, lib_bmp::my_color> l_color_correspondance;
 
@@ -705,17 +1264,45 @@ namespace steganogif
         splitted_list<int> l_splitted_list_v{l_list_v.to_vector()};
         std::cout << l_splitted_list_v << std::endl;
         l_splitted_list_v.compute_average();
+#ifdef VERBOSE_STEGANOGIF
+        std::cout << "Splits Y/U/V : " << l_list_y.get_nb_splits() << "/" << l_list_u.get_nb_splits() << "/" << l_list_v.get_nb_splits() << std::endl;
+#endif // VERBOSE_STEGANOGIF
 
-        std::map<lib_bmp::my_color, lib_bmp::my_color> l_color_correspondance;
+        // Colors are converted in one go from component buffers, forward
+        // conversion being the one used to collect YUV statistics
+        size_t l_nb_colors = p_all_colors.size();
+        std::vector<uint8_t> l_reds(l_nb_colors);
+        std::vector<uint8_t> l_greens(l_nb_colors);
+        std::vector<uint8_t> l_blues(l_nb_colors);
+        size_t l_index = 0;
+        for(auto l_iter: p_all_colors)
+        {
+            l_reds[l_index] = l_iter.get_red();
+            l_greens[l_index] = l_iter.get_green();
+            l_blues[l_index] = l_iter.get_blue();
+            ++l_index;
+        }
+        std::vector<int16_t> l_ys(l_nb_colors);
+        std::vector<int16_t> l_us(l_nb_colors);
+        std::vector<int16_t> l_vs(l_nb_colors);
+        yuv_kernels::to_yuv_fixed(l_reds.data(), l_greens.data(), l_blues.data(), l_ys.data(), l_us.data(), l_vs.data(), l_nb_colors);
+        for(l_index = 0; l_index < l_nb_colors; ++l_index)
+        {
+            l_ys[l_index] = (int16_t)l_splitted_list_y.get_average(l_ys[l_index]);
+            l_us[l_index] = (int16_t)l_splitted_list_u.get_average(l_us[l_index]);
+            l_vs[l_index] = (int16_t)l_splitted_list_v.get_average(l_vs[l_index]);
+        }
+        std::vector<uint8_t> l_translated_reds(l_nb_colors);
+        std::vector<uint8_t> l_translated_greens(l_nb_colors);
+        std::vector<uint8_t> l_translated_blues(l_nb_colors);
+        yuv_kernels::to_rgb_fixed(l_ys.data(), l_us.data(), l_vs.data(), l_translated_reds.data(), l_translated_greens.data(), l_translated_blues.data(), l_nb_colors);
 
+        std::map<lib_bmp::my_color, lib_bmp::my_color> l_color_correspondance;
+        l_index = 0;
         for(auto l_iter: p_all_colors)
         {
-            yuv_color l_yuv{l_iter};
-            yuv_color l_translated_yuv{ (float)l_splitted_list_y.get_average(l_yuv.get_y())
-                                      , (float)l_splitted_list_u.get_average(l_yuv.get_u())
-                                      , (float)l_splitted_list_v.get_average(l_yuv.get_v())
-                                      };
-            l_color_correspondance[l_iter] = l_translated_yuv.to_rgb_color();
+            l_color_correspondance.emplace_hint(l_color_correspondance.end(), l_iter, lib_bmp::my_color(l_translated_reds[l_index], l_translated_greens[l_index], l_translated_blues[l_index]));
+            ++l_index;
         }
         return l_color_correspondance;
     }
@@ -740,35 +1327,19 @@ namespace steganogif
     steganogif::compute_simplified_colors(const lib_bmp::my_bmp & p_bmp)
     {
         // Collect color stats
-        std::set<lib_bmp::my_color> l_all_colors;
-        std::map<uint8_t, unsigned int> l_red_colors;
-        std::map<uint8_t, unsigned int> l_green_colors;
-        std::map<uint8_t, unsigned int> l_blue_colors;
-        std::map<int, unsigned int> l_y_colors;
-        std::map<int, unsigned int> l_u_colors;
-        std::map<int, unsigned int> l_v_colors;
-        std::map<yuv_color, unsigned int> l_all_yuv_colors;
-        for(unsigned int l_y = 0; l_y < p_bmp.get_height(); ++l_y)
-        {
-            for(unsigned int l_x = 0; l_x < p_bmp.get_width(); ++l_x)
-            {
-                lib_bmp::my_color l_color = p_bmp.get_pixel_color(l_x, l_y);
-                l_all_colors.insert(l_color);
-                l_red_colors[l_color.get_red()]++;
-                l_green_colors[l_color.get_green()]++;
-                l_blue_colors[l_color.get_blue()]++;
-                yuv_color l_yuv_color{l_color};
-                l_y_colors[(int)l_yuv_color.get_y()]++;
-                l_u_colors[(int)l_yuv_color.get_u()]++;
-                l_v_colors[(int)l_yuv_color.get_v()]++;
-                l_all_yuv_colors[l_yuv_color]++;
-            }
-        }
+        color_statistics l_statistics{p_bmp};
+        std::set<lib_bmp::my_color> l_all_colors = l_statistics.get_colors();
+        std::map<uint8_t, unsigned int> l_red_colors = color_statistics::to_map<uint8_t>(l_statistics.get_red_histogram());
+        std::map<uint8_t, unsigned int> l_green_colors = color_statistics::to_map<uint8_t>(l_statistics.get_green_histogram());
+        std::map<uint8_t, unsigned int> l_blue_colors = color_statistics::to_map<uint8_t>(l_statistics.get_blue_histogram());
+        std::map<int, unsigned int> l_y_colors = color_statistics::to_map<int>(l_statistics.get_y_histogram(), color_statistics::m_yuv_offset);
+        std::map<int, unsigned int> l_u_colors = color_statistics::to_map<int>(l_statistics.get_u_histogram(), color_statistics::m_yuv_offset);
+        std::map<int, unsigned int> l_v_colors = color_statistics::to_map<int>(l_statistics.get_v_histogram(), color_statistics::m_yuv_offset);
         std::cout << "All colors : " << l_all_colors.size() << std::endl;
         std::cout << "Red colors : " << l_red_colors.size() << std::endl;
         std::cout << "Green colors : " << l_green_colors.size() << std::endl;
         std::cout << "Blue colors : " << l_blue_colors.size() << std::endl;
-        std::cout << "YUV colors : " << l_all_yuv_colors.size() << std::endl;
+        std::cout << "YUV colors : " << l_statistics.get_nb_yuv_colors() << std::endl;
         std::cout << "Y colors : " << l_y_colors.size() << std::endl;
         std::cout << "U colors : " << l_u_colors.size() << std::endl;
         std::cout << "V colors : " << l_v_colors.size() << std::endl;
@@ -788,105 +1359,129 @@ namespace steganogif
     }
 
     //-------------------------------------------------------------------------
-    lib_bmp::my_bmp
-    steganogif::compute_128_color_bmp(const lib_bmp::my_bmp & p_bmp)
+    void
+    steganogif::extend_palette(indexed_picture & p_picture)
     {
+        // obtain a seed from the system clock:
+        std::mt19937 l_color_generator{(unsigned int)std::chrono::system_clock::now().time_since_epoch().count()};
+        std::set<lib_bmp::my_color> l_used_colors;
+        for(unsigned int l_index = 0; l_index < 128; ++l_index)
+        {
+            l_used_colors.insert(p_picture.get_color(l_index));
+        }
+        for(unsigned int l_index = 128;l_index < 256; ++l_index)
         {
-            // Copy BMP content
-            lib_bmp::my_bmp l_new_bmp(p_bmp.get_width(), p_bmp.get_height(), 8);
-            for (unsigned int l_y = 0; l_y < p_bmp.get_height(); ++l_y)
+            unsigned int l_componant_index = l_color_generator() % 3;
+            unsigned int l_offset = (1 + (l_color_generator() % 14));
+            assert(lib_bmp::my_color(0,0,0) == p_picture.get_color(l_index));
+            lib_bmp::my_color l_original_color = p_picture.get_color(l_index - 128);
+#ifdef VERBOSE_STEGANOGIF
+            std::cout << "[" << l_index << "] " << l_original_color << " => " ;
+#endif // VERBOSE_STEGANOGIF
+            // Palette colors are not necessarily far from each other so
+            // other componant/offset combinations are tried until color is
+            // not already in palette
+            lib_bmp::my_color l_new_color{l_original_color};
+            unsigned int l_nb_tries = 0;
+            do
             {
-                for (unsigned int l_x = 0; l_x < p_bmp.get_width(); ++l_x)
+                if(3 * 14 == l_nb_tries)
                 {
-                    l_new_bmp.set_pixel_color(l_x, l_y, p_bmp.get_pixel_color(l_x, l_y));
+                    std::stringstream l_color_stream;
+                    l_color_stream << l_original_color;
+                    throw quicky_exception::quicky_logic_exception("Unable to find color close to " + l_color_stream.str() + " not already in palette", __LINE__, __FILE__);
                 }
-            }
-
-            // Create 128 color palette
-            std::array<uint8_t, 4> l_red_components
-            { 0
-            , 64
-            , 128
-            , 255
-            };
-
-            std::array<uint8_t, 8> l_green_components
-            { 0
-            , 32
-            , 64
-            , 96
-            , 128
-            , 160
-            , 192
-            , 255
-            };
-
-            unsigned int l_index = 0;
-            for (auto l_iter_red: l_red_components)
-            {
-                for (auto l_iter_green: l_green_components)
+                if(l_nb_tries)
                 {
-                    for (auto l_iter_blue: l_red_components)
+                    l_offset = l_offset % 14 + 1;
+                    if(1 == l_offset)
                     {
-                        l_new_bmp.get_palette().set_color(lib_bmp::my_color_alpha(l_iter_red, l_iter_green, l_iter_blue), l_index);
-                        ++l_index;
+                        l_componant_index = (l_componant_index + 1) % 3;
                     }
                 }
+                ++l_nb_tries;
+                l_new_color = l_original_color;
+                unsigned int l_componant = (0 ==l_componant_index ) ? l_original_color.get_red() : ((1 == l_componant_index) ? l_original_color.get_green() : l_original_color.get_blue());
+                l_componant = l_componant + l_offset <= 255 ? l_componant + l_offset : l_componant - l_offset;
+                switch (l_componant_index)
+                {
+                    case 0:
+                        l_new_color.set_red(l_componant);
+                        break;
+                    case 1:
+                        l_new_color.set_green(l_componant);
+                        break;
+                    case 2:
+                        l_new_color.set_blue(l_componant);
+                        break;
+                    default:
+                        throw quicky_exception::quicky_logic_exception("Unknowm componant index : " + std::to_string(l_componant_index), __LINE__, __FILE__);
+                }
             }
-            assert(128 == l_index);
-            while (l_index < 256)
-            {
-                l_new_bmp.get_palette().set_color(lib_bmp::my_color_alpha(0,0,0), l_index);
-                ++l_index;
-            }
-
-            l_new_bmp.save("128_color.bmp");
+            while(!l_used_colors.insert(l_new_color).second);
+#ifdef VERBOSE_STEGANOGIF
+            std::cout << l_new_color << std::endl ;
+#endif // VERBOSE_STEGANOGIF
+            p_picture.set_color(l_index, l_new_color);
         }
-        lib_bmp::my_bmp l_new_bmp{"128_color.bmp"};
-        return l_new_bmp;
     }
 
     //-------------------------------------------------------------------------
-    void
-    steganogif::extend_palette(lib_bmp::my_bmp & p_bmp)
+    std::map<lib_bmp::my_color, lib_bmp::my_color>
+    steganogif::compute_color_correspondance(const std::set<lib_bmp::my_color> & p_colors)
     {
-        // obtain a seed from the system clock:
-        std::mt19937 l_color_generator{(unsigned int)std::chrono::system_clock::now().time_since_epoch().count()};
-        for(unsigned int l_index = 128;l_index < 256; ++l_index)
+        if(p_colors.size() % 2)
         {
-            unsigned int l_componant_index = l_color_generator() % 3;
-            assert(lib_bmp::my_color_alpha(0,0,0) == p_bmp.get_palette().get_color(l_index));
-            lib_bmp::my_color_alpha l_original_color = p_bmp.get_palette().get_color(l_index - 128);
-#ifdef VERBOSE_STEGANOGIF
-            std::cout << "[" << l_index << "] " << l_original_color << " => " ;
-#endif // VERBOSE_STEGANOGIF
-            unsigned int l_componant = (0 ==l_componant_index ) ? l_original_color.get_red() : ((1 == l_componant_index) ? l_original_color.get_green() : l_original_color.get_blue());
-            unsigned int l_offset = (1 + (l_color_generator() % 14));
-            l_componant = l_componant != 255 ? l_componant + l_offset : l_componant - l_offset;
-            switch (l_componant_index)
+            throw quicky_exception::quicky_logic_exception("Number of color should be even : " + std::to_string(p_colors.size()), __LINE__, __FILE__);
+        }
+        std::vector<lib_bmp::my_color> l_colors{p_colors.begin(), p_colors.end()};
+
+        // List all pairs sorted by distance then by color order. Taking
+        // pairs in this order while skipping already paired colors gives
+        // the same result as repeatedly searching closest remaining colors.
+        // Each pair is packed as squared distance (18 bits) followed by
+        // indexes of both colors (23 bits each) so sorting is done on integers
+        if(l_colors.size() > (1u << 23))
+        {
+            throw quicky_exception::quicky_logic_exception("Too many colors : " + std::to_string(l_colors.size()), __LINE__, __FILE__);
+        }
+        const uint64_t l_index_mask = (1u << 23) - 1;
+        std::vector<uint64_t> l_edges;
+        l_edges.reserve(l_colors.size() * (l_colors.size() / 2));
+        for(uint64_t l_index1 = 0; l_index1 < l_colors.size(); ++l_index1)
+        {
+            for(uint64_t l_index2 = l_index1 + 1; l_index2 < l_colors.size(); ++l_index2)
             {
-                case 0:
-                    l_original_color.set_red(l_componant);
-                    break;
-                case 1:
-                    l_original_color.set_green(l_componant);
-                    break;
-                case 2:
-                    l_original_color.set_blue(l_componant);
-                    break;
-                default:
-                    throw quicky_exception::quicky_logic_exception("Unknowm componant index : " + std::to_string(l_componant_index), __LINE__, __FILE__);
+                l_edges.emplace_back(((uint64_t)square_dist(l_colors[l_index1], l_colors[l_index2]) << 46) | (l_index1 << 23) | l_index2);
+            }
+        }
+        std::sort(l_edges.begin(), l_edges.end());
+
+        std::map<lib_bmp::my_color, lib_bmp::my_color> l_color_correspondance;
+        std::vector<bool> l_paired(l_colors.size(), false);
+        for(auto l_edge_iter = l_edges.begin(); l_color_correspondance.size() < l_colors.size() && l_edge_iter != l_edges.end(); ++l_edge_iter)
+        {
+            unsigned int l_lower_index = (*l_edge_iter >> 23) & l_index_mask;
+            unsigned int l_upper_index = *l_edge_iter & l_index_mask;
+            if(l_paired[l_lower_index] || l_paired[l_upper_index])
+            {
+                continue;
             }
 #ifdef VERBOSE_STEGANOGIF
-            std::cout << l_original_color << std::endl ;
+            std::cout << l_colors[l_upper_index] << " <==> " << l_colors[l_lower_index] << " : " << sqrt(*l_edge_iter >> 46) << std::endl;
 #endif // VERBOSE_STEGANOGIF
-            p_bmp.get_palette().set_color(l_original_color, l_index);
+            l_color_correspondance.insert(std::make_pair(l_colors[l_lower_index], l_colors[l_upper_index]));
+            l_color_correspondance.insert(std::make_pair(l_colors[l_upper_index], l_colors[l_lower_index]));
+            l_paired[l_lower_index] = true;
+            l_paired[l_upper_index] = true;
         }
+        return l_color_correspondance;
     }
 
+#ifdef STEGANOGIF_SELF_TEST
     //-------------------------------------------------------------------------
     std::map<lib_bmp::my_color, lib_bmp::my_color>
-    steganogif::compute_color_correspondance(const std::set<lib_bmp::my_color> & p_colors)
+    steganogif::compute_color_correspondance_reference(const std::set<lib_bmp::my_color> & p_colors)
     {
         if(p_colors.size() % 2)
         {
@@ -931,87 +1526,92 @@ namespace steganogif
     }
 
     //-------------------------------------------------------------------------
-    void
-    steganogif::encode_pixel( unsigned int p_x
-                            , unsigned int p_y
-                            , bool p_data
-                            , bool p_swap
-                            , const std::map<lib_bmp::my_color, lib_bmp::my_color> & p_color_correspondance
-                            , lib_bmp::my_bmp & p_bmp
-                            )
+    bool
+    steganogif::self_test()
     {
-        lib_bmp::my_color l_origin_color = p_bmp.get_pixel_color(p_x, p_y);
-        auto l_iter = p_color_correspondance.find(l_origin_color);
-        assert(l_iter != p_color_correspondance.end());
-        lib_bmp::my_color l_related_color = l_iter->second;
-        if(l_origin_color > l_related_color)
-        {
-            std::swap(l_origin_color, l_related_color);
-        }
-        if(p_data ^ p_swap)
+        std::mt19937 l_generator{0};
+        bool l_success = true;
+        // Coarse component step produces many equal distances to check ties
+        for(unsigned int l_step: {1u, 32u})
         {
-            p_bmp.set_pixel_color(p_x, p_y, lib_bmp::my_color_alpha(l_related_color));
-        }
-        else
-        {
-            p_bmp.set_pixel_color(p_x, p_y, lib_bmp::my_color_alpha(l_origin_color));
+            for(unsigned int l_nb_colors: {16u, 64u, 128u, 256u})
+            {
+                std::set<lib_bmp::my_color> l_colors;
+                while(l_colors.size() < l_nb_colors)
+                {
+                    l_colors.insert(lib_bmp::my_color( l_step * (l_generator() % (256 / l_step))
+                                                     , l_step * (l_generator() % (256 / l_step))
+                                                     , l_step * (l_generator() % (256 / l_step))
+                                                     ));
+                }
+                auto l_start = std::chrono::steady_clock::now();
+                std::map<lib_bmp::my_color, lib_bmp::my_color> l_reference = compute_color_correspondance_reference(l_colors);
+                auto l_middle = std::chrono::steady_clock::now();
+                std::map<lib_bmp::my_color, lib_bmp::my_color> l_result = compute_color_correspondance(l_colors);
+                auto l_end = std::chrono::steady_clock::now();
+                bool l_identical = l_reference == l_result;
+                l_success &= l_identical;
+                std::cout << "Color correspondance of " << l_nb_colors << " colors with step " << l_step;
+                std::cout << " : reference " << std::chrono::duration_cast<std::chrono::microseconds>(l_middle - l_start).count() << "us";
+                std::cout << ", sorted pairs " << std::chrono::duration_cast<std::chrono::microseconds>(l_end - l_middle).count() << "us";
+                std::cout << " => " << (l_identical ? "OK" : "KO") << std::endl;
+            }
         }
+        l_success &= splittable_list<uint8_t>::self_test();
+        l_success &= splittable_list<int>::self_test();
+        l_success &= splitted_list<uint8_t>::self_test();
+        l_success &= splitted_list<int>::self_test();
+        return l_success;
     }
 
+#endif // STEGANOGIF_SELF_TEST
+
     //-------------------------------------------------------------------------
-    bool
-    steganogif::decode_pixel( unsigned int p_x
-                            , unsigned int p_y
-                            , bool p_swap
-                            , const std::map<lib_bmp::my_color, lib_bmp::my_color> & p_color_correspondance
-                            , lib_bmp::my_bmp & p_bmp
-                            )
+    std::vector<lib_bmp::my_color>
+    steganogif::get_palette_colors(const lib_bmp::my_bmp & p_bmp)
     {
-        const lib_bmp::my_color & l_pixel_color = p_bmp.get_pixel_color(p_x, p_y);
-        auto l_iter = p_color_correspondance.find(l_pixel_color);
-        assert(l_iter != p_color_correspondance.end());
-        lib_bmp::my_color l_related_color = l_iter->second;
-        bool l_data = l_related_color < l_pixel_color;
-        l_data = l_data ^ p_swap;
-        return l_data;
+        std::vector<lib_bmp::my_color> l_colors;
+        for(unsigned int l_index = 0; l_index < p_bmp.get_palette().get_size(); ++l_index)
+        {
+            l_colors.emplace_back(p_bmp.get_palette().get_color(l_index));
+        }
+        return l_colors;
     }
 
     //-------------------------------------------------------------------------
-    std::vector<std::pair<unsigned int, unsigned int>>
-    steganogif::generate_pixel_list(const lib_bmp::my_bmp & p_bmp)
+    template <typename OFFSET_TYPE>
+    std::vector<OFFSET_TYPE>
+    steganogif::generate_pixel_list(uint32_t p_nb_pixels)
     {
-        std::vector<std::pair<unsigned int, unsigned int>> l_pixels;
-        for(unsigned int l_y = 0; l_y < p_bmp.get_height(); ++l_y)
+        if(p_nb_pixels - 1 > std::numeric_limits<OFFSET_TYPE>::max())
         {
-            for(unsigned int l_x = 0; l_x < p_bmp.get_width(); ++l_x)
-            {
-                l_pixels.emplace_back(std::make_pair(l_x, l_y));
-            }
+            throw quicky_exception::quicky_logic_exception("Pixel offset type is too small for " + std::to_string(p_nb_pixels) + " pixels", __LINE__, __FILE__);
         }
+        std::vector<OFFSET_TYPE> l_pixels(p_nb_pixels);
+        std::iota(l_pixels.begin(), l_pixels.end(), 0);
         return l_pixels;
     }
 
     //-------------------------------------------------------------------------
     void
-    steganogif::encode_picture( lib_bmp::my_bmp & p_bmp
-                              , std::vector<uint8_t> & p_content
-                              , std::vector<std::pair<unsigned int, unsigned int>> & p_pixels
-                              , const std::map<lib_bmp::my_color, lib_bmp::my_color> & p_color_correspondance
-                              , std::mt19937 & p_generator
-                              , const uint64_t & p_offset
+    steganogif::encode_picture( indexed_picture & p_picture
+                              , const std::vector<uint8_t> & p_content
+                              , const keyed_permutation & p_permutation
+                              , const palette_pairing & p_pairing
+                              , std::mt19937 & p_data_generator
                               )
     {
-        unsigned int l_remaining_pixel_index = p_bmp.get_width() * p_bmp.get_height();
-        std::mt19937 l_data_generator{(unsigned int)std::chrono::system_clock::now().time_since_epoch().count()};
-        if(!l_remaining_pixel_index)
+        std::vector<uint8_t> & l_indexes = p_picture.get_indexes();
+        if(p_permutation.get_size() != l_indexes.size())
         {
-            throw quicky_exception::quicky_logic_exception("Pixel index start at zero", __LINE__, __FILE__);
+            throw quicky_exception::quicky_logic_exception("Permutation size differs from number of pixels", __LINE__, __FILE__);
         }
-        for(unsigned int l_pixel_index = 0; l_remaining_pixel_index; ++l_pixel_index, --l_remaining_pixel_index)
+
+        // Bits are first dispatched on their pixels then applied in bulk
+        std::vector<uint8_t> l_bits(l_indexes.size());
+        for(unsigned int l_pixel_index = 0; l_pixel_index < p_permutation.get_size(); ++l_pixel_index)
         {
-            unsigned int l_swap_index = l_pixel_index + (p_generator() % l_remaining_pixel_index);
-            std::swap(p_pixels[l_pixel_index], p_pixels[l_swap_index]);
-            unsigned int l_byte_index = p_offset + l_pixel_index / 8;
+            unsigned int l_byte_index = l_pixel_index / 8;
             bool l_data;
             if(l_byte_index < p_content.size())
             {
@@ -1020,35 +1620,89 @@ namespace steganogif
             }
             else
             {
-                l_data = l_data_generator() % 2;
+                l_data = p_data_generator() % 2;
+            }
+            l_bits[p_permutation(l_pixel_index)] = l_data ^ p_permutation.get_bit(l_pixel_index);
+        }
+        p_pairing.encode(l_indexes, l_bits);
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    steganogif::decode_picture( const indexed_picture & p_picture
+                              , std::vector<uint8_t> & p_content
+                              , const keyed_permutation & p_permutation
+                              , const palette_pairing & p_pairing
+                              , unsigned int p_nb_bytes
+                              )
+    {
+        const std::vector<uint8_t> & l_indexes = p_picture.get_indexes();
+        if(p_permutation.get_size() != l_indexes.size())
+        {
+            throw quicky_exception::quicky_logic_exception("Permutation size differs from number of pixels", __LINE__, __FILE__);
+        }
+
+        // When only some bytes are requested their pixels are read one by one
+        if(p_nb_bytes < p_permutation.get_size() / 8)
+        {
+            for(unsigned int l_byte_index = 0; l_byte_index < p_nb_bytes; ++l_byte_index)
+            {
+                uint8_t l_byte = 0;
+                for(unsigned int l_bit_index = 0; l_bit_index < 8; ++l_bit_index)
+                {
+                    unsigned int l_pixel_index = 8 * l_byte_index + l_bit_index;
+                    bool l_data = p_pairing.decode(l_indexes[p_permutation(l_pixel_index)]) ^ p_permutation.get_bit(l_pixel_index);
+                    l_byte |= ((unsigned int) l_data) << l_bit_index;
+                }
+                p_content.emplace_back(l_byte);
+            }
+            return;
+        }
+
+        // Bits are first extracted in bulk then collected from their pixels
+        std::vector<uint8_t> l_bits;
+        p_pairing.decode(l_indexes, l_bits);
+        uint8_t l_byte = 0;
+        for(unsigned int l_pixel_index = 0; l_pixel_index < p_permutation.get_size(); ++l_pixel_index)
+        {
+            unsigned int l_bit_index = l_pixel_index % 8;
+            bool l_data = l_bits[p_permutation(l_pixel_index)] ^ p_permutation.get_bit(l_pixel_index);
+            l_byte |= ((unsigned int) l_data) << l_bit_index;
+            if(7 == l_bit_index)
+            {
+                p_content.emplace_back(l_byte);
+                l_byte = 0;
             }
-            bool l_swap = p_generator() % 2;
-            encode_pixel(p_pixels[l_pixel_index].first, p_pixels[l_pixel_index].second, l_data, l_swap, p_color_correspondance, p_bmp);
         }
     }
 
     //-------------------------------------------------------------------------
+    template <typename OFFSET_TYPE>
     void
-    steganogif::decode_picture( lib_bmp::my_bmp & p_bmp
-            , std::vector<uint8_t> & p_content
-            , std::vector<std::pair<unsigned int, unsigned int>> & p_pixels
-            , const std::map<lib_bmp::my_color, lib_bmp::my_color> & p_color_correspondance
-            , std::mt19937 & p_generator
+    steganogif::decode_picture( const indexed_picture & p_picture
+                              , std::vector<uint8_t> & p_content
+                              , std::vector<OFFSET_TYPE> & p_pixels
+                              , const palette_pairing & p_pairing
+                              , std::mt19937 & p_generator
+                              , unsigned int p_nb_bytes
                               )
     {
-        unsigned int l_remaining_pixel_index = p_bmp.get_width() * p_bmp.get_height();
+        const std::vector<uint8_t> & l_indexes = p_picture.get_indexes();
+        unsigned int l_remaining_pixel_index = l_indexes.size();
         if(!l_remaining_pixel_index)
         {
             throw quicky_exception::quicky_logic_exception("Pixel index start at zero", __LINE__, __FILE__);
         }
+        assert(p_pixels.size() == l_indexes.size());
+        unsigned int l_nb_pixels = p_nb_bytes < l_indexes.size() / 8 ? 8 * p_nb_bytes : l_indexes.size();
         uint8_t l_byte = 0;
-        for(unsigned int l_pixel_index = 0; l_remaining_pixel_index; ++l_pixel_index, --l_remaining_pixel_index)
+        for(unsigned int l_pixel_index = 0; l_pixel_index < l_nb_pixels; ++l_pixel_index, --l_remaining_pixel_index)
         {
             unsigned int l_swap_index = l_pixel_index + (p_generator() % l_remaining_pixel_index);
             std::swap(p_pixels[l_pixel_index], p_pixels[l_swap_index]);
             unsigned int l_bit_index = l_pixel_index % 8;
             bool l_swap = p_generator() % 2;
-            bool l_data = decode_pixel(p_pixels[l_pixel_index].first, p_pixels[l_pixel_index].second, l_swap, p_color_correspondance, p_bmp);
+            bool l_data = p_pairing.decode(l_indexes[p_pixels[l_pixel_index]]) ^ l_swap;
             l_byte |= ((unsigned int) l_data) << l_bit_index;
             if(7 == l_bit_index)
             {
@@ -1059,33 +1713,29 @@ namespace steganogif
     }
 
     //-------------------------------------------------------------------------
-    lib_bmp::my_color
-    steganogif::to_bmp_color(const lib_gif::gif_color & p_color)
+    uint32_t
+    steganogif::compute_frame_digest( uint32_t p_frame_index
+                                    , const uint8_t * p_data
+                                    , size_t p_size
+                                    )
     {
-        return lib_bmp::my_color(p_color.get_red(), p_color.get_green(), p_color.get_blue());
+        incremental_sha1 l_sha1;
+        l_sha1.update((const uint8_t*)&p_frame_index, sizeof(uint32_t));
+        l_sha1.update(p_data, p_size);
+        l_sha1.finalize();
+        return l_sha1.get_key(0);
     }
 
     //-------------------------------------------------------------------------
     std::map<lib_bmp::my_color, lib_bmp::my_color>
-    steganogif::compute_color_correspondance( const lib_gif::gif_color_table & p_color_table
-                                            , lib_bmp::my_bmp & p_bmp
+    steganogif::compute_color_correspondance( const std::vector<lib_bmp::my_color> & p_color_table
+                                            , std::vector<lib_bmp::my_color> & p_palette
                                             )
     {
         std::map<lib_bmp::my_color, lib_bmp::my_color> l_color_correspondance;
-        std::set<lib_bmp::my_color> l_colors;
-        for(unsigned int l_color_index = 0; l_color_index < p_color_table.get_size(); ++l_color_index)
-        {
-            lib_gif::gif_color l_gif_color = p_color_table[l_color_index];
-            lib_bmp::my_color l_bmp_color = to_bmp_color(l_gif_color);
-            p_bmp.get_palette().set_color(lib_bmp::my_color_alpha(l_bmp_color), l_color_index);
-            l_colors.insert(l_bmp_color);
-        }
-        for(unsigned int l_color_index = p_color_table.get_size(); l_color_index < 256; ++l_color_index)
-        {
-            lib_bmp::my_color l_bmp_color;
-            p_bmp.get_palette().set_color(lib_bmp::my_color_alpha(l_bmp_color), l_color_index);
-            l_colors.insert(l_bmp_color);
-        }
+        p_palette = p_color_table;
+        p_palette.resize(256);
+        std::set<lib_bmp::my_color> l_colors(p_palette.begin(), p_palette.end());
         if(l_colors.size() % 2)
         {
             throw quicky_exception::quicky_logic_exception("Number of color is not odd", __LINE__, __FILE__);
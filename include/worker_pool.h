@@ -0,0 +1,187 @@
+/*
+      This file is part of steganogif
+      Copyright (C) 2020  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU General Public License as published by
+      the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+      GNU General Public License for more details.
+
+      You should have received a copy of the GNU General Public License
+      along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef STEGANOGIF_WORKER_POOL_H
+#define STEGANOGIF_WORKER_POOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <deque>
+#include <algorithm>
+#include <vector>
+
+namespace steganogif
+{
+    /**
+     * Fixed set of threads executing submitted tasks
+     */
+    class worker_pool
+    {
+      public:
+        /**
+         * Constructor
+         * @param p_nb_workers number of threads, 0 means one per hardware thread
+         */
+        inline explicit
+        worker_pool(unsigned int p_nb_workers = 0);
+
+        inline
+        ~worker_pool();
+
+        worker_pool(const worker_pool &) = delete;
+
+        worker_pool & operator=(const worker_pool &) = delete;
+
+        inline
+        unsigned int get_nb_workers() const;
+
+        inline
+        void submit(std::function<void()> p_task);
+
+        /**
+         * Wait for completion of all submitted tasks. Exception thrown by
+         * a task is rethrown here
+         */
+        inline
+        void wait();
+
+      private:
+
+        inline
+        void run();
+
+        std::vector<std::thread> m_workers;
+        std::deque<std::function<void()>> m_tasks;
+        std::mutex m_mutex;
+        std::condition_variable m_task_condition;
+        std::condition_variable m_done_condition;
+
+        /**
+         * Number of tasks submitted and not yet completed
+         */
+        unsigned int m_nb_pending;
+        bool m_stop;
+        std::exception_ptr m_exception;
+    };
+
+    //-------------------------------------------------------------------------
+    worker_pool::worker_pool(unsigned int p_nb_workers)
+    : m_nb_pending(0)
+    , m_stop(false)
+    {
+        if(!p_nb_workers)
+        {
+            p_nb_workers = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for(unsigned int l_index = 0; l_index < p_nb_workers; ++l_index)
+        {
+            m_workers.emplace_back(&worker_pool::run, this);
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    worker_pool::~worker_pool()
+    {
+        {
+            std::lock_guard<std::mutex> l_lock(m_mutex);
+            m_stop = true;
+        }
+        m_task_condition.notify_all();
+        for(auto & l_iter: m_workers)
+        {
+            l_iter.join();
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    unsigned int
+    worker_pool::get_nb_workers() const
+    {
+        return m_workers.size();
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    worker_pool::submit(std::function<void()> p_task)
+    {
+        {
+            std::lock_guard<std::mutex> l_lock(m_mutex);
+            m_tasks.emplace_back(std::move(p_task));
+            ++m_nb_pending;
+        }
+        m_task_condition.notify_one();
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    worker_pool::wait()
+    {
+        std::unique_lock<std::mutex> l_lock(m_mutex);
+        m_done_condition.wait(l_lock, [this]{return !m_nb_pending;});
+        if(m_exception)
+        {
+            std::exception_ptr l_exception = m_exception;
+            m_exception = nullptr;
+            std::rethrow_exception(l_exception);
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    worker_pool::run()
+    {
+        for(;;)
+        {
+            std::function<void()> l_task;
+            {
+                std::unique_lock<std::mutex> l_lock(m_mutex);
+                m_task_condition.wait(l_lock, [this]{return m_stop || !m_tasks.empty();});
+                if(m_tasks.empty())
+                {
+                    return;
+                }
+                l_task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            std::exception_ptr l_exception;
+            try
+            {
+                l_task();
+            }
+            catch(...)
+            {
+                l_exception = std::current_exception();
+            }
+            {
+                std::lock_guard<std::mutex> l_lock(m_mutex);
+                if(l_exception && !m_exception)
+                {
+                    m_exception = l_exception;
+                }
+                --m_nb_pending;
+            }
+            m_done_condition.notify_all();
+        }
+    }
+
+}
+#endif //STEGANOGIF_WORKER_POOL_H
+// EOF
@@ -0,0 +1,332 @@
+/*
+      This file is part of steganogif
+      Copyright (C) 2020  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU General Public License as published by
+      the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+      GNU General Public License for more details.
+
+      You should have received a copy of the GNU General Public License
+      along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef STEGANOGIF_YUV_KERNELS_H
+#define STEGANOGIF_YUV_KERNELS_H
+
+#include <cstddef>
+#include <cinttypes>
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif // __AVX2__
+
+namespace steganogif
+{
+    /**
+     * Bulk RGB <-> YUV conversions of rows stored as one array per
+     * component, using the coefficients of yuv_color in fixed point.
+     * YUV components are integers: forward conversion rounds them down
+     * and, as it only involves integer arithmetic, gives the same result
+     * whatever the code path so it can be used to compute keys of lookup
+     * tables.
+     * AVX2 or SSE2 versions are used depending on compilation flags,
+     * scalar code handles remaining pixels
+     */
+    class yuv_kernels
+    {
+      public:
+        /**
+         * Convert RGB components to integer YUV components rounded down
+         * @param p_reds red components
+         * @param p_greens green components
+         * @param p_blues blue components
+         * @param p_ys receive Y components in [0:255]
+         * @param p_us receive U components in [-112:111]
+         * @param p_vs receive V components in [-157:156]
+         * @param p_size number of pixels
+         */
+        inline static
+        void to_yuv_fixed( const uint8_t * p_reds
+                         , const uint8_t * p_greens
+                         , const uint8_t * p_blues
+                         , int16_t * p_ys
+                         , int16_t * p_us
+                         , int16_t * p_vs
+                         , size_t p_size
+                         );
+
+        /**
+         * Convert integer YUV components to RGB, components being rounded
+         * to nearest integer then clamped
+         * @param p_ys Y components
+         * @param p_us U components
+         * @param p_vs V components
+         * @param p_reds receive red components
+         * @param p_greens receive green components
+         * @param p_blues receive blue components
+         * @param p_size number of pixels
+         */
+        inline static
+        void to_rgb_fixed( const int16_t * p_ys
+                         , const int16_t * p_us
+                         , const int16_t * p_vs
+                         , uint8_t * p_reds
+                         , uint8_t * p_greens
+                         , uint8_t * p_blues
+                         , size_t p_size
+                         );
+
+      private:
+
+        /**
+         * Coefficients of forward conversion in 2.14 fixed point. Each
+         * line sums to 1 for Y and 0 for U and V so that grey colors are
+         * converted exactly
+         */
+        static constexpr int16_t m_y_red = 4899;
+        static constexpr int16_t m_y_green = 9617;
+        static constexpr int16_t m_y_blue = 1868;
+        static constexpr int16_t m_u_red = -2410;
+        static constexpr int16_t m_u_green = -4733;
+        static constexpr int16_t m_u_blue = 7143;
+        static constexpr int16_t m_v_red = 10076;
+        static constexpr int16_t m_v_green = -8437;
+        static constexpr int16_t m_v_blue = -1639;
+        static constexpr unsigned int m_yuv_shift = 14;
+
+        /**
+         * Coefficients of backward conversion in 3.13 fixed point
+         */
+        static constexpr int16_t m_one = 8192;
+        static constexpr int16_t m_red_v = 9338;
+        static constexpr int16_t m_green_u = -3233;
+        static constexpr int16_t m_green_v = -4756;
+        static constexpr int16_t m_blue_u = 16647;
+        static constexpr unsigned int m_rgb_shift = 13;
+
+        /**
+         * Clamp value to a color component
+         */
+        inline static
+        uint8_t clamp(long p_value);
+
+        /**
+         * Value of 32 bits lane whose low and high 16 bits parts are
+         * multiplied by madd instructions with interleaved operands
+         */
+        inline static
+        int pair( int16_t p_low
+                , int16_t p_high
+                );
+    };
+
+    //-------------------------------------------------------------------------
+    void
+    yuv_kernels::to_yuv_fixed( const uint8_t * p_reds
+                             , const uint8_t * p_greens
+                             , const uint8_t * p_blues
+                             , int16_t * p_ys
+                             , int16_t * p_us
+                             , int16_t * p_vs
+                             , size_t p_size
+                             )
+    {
+        size_t l_index = 0;
+#if defined(__AVX2__)
+        // Red and green are interleaved to be multiplied and summed by one
+        // madd instruction, blue being interleaved with zero. Unpack and
+        // pack instructions work inside 128 bits lanes so initial order is
+        // restored by the final pack
+        const __m256i l_zero = _mm256_setzero_si256();
+        auto l_convert = [&](__m256i p_red_green_low, __m256i p_red_green_high, __m256i p_blue_low, __m256i p_blue_high, int16_t p_red, int16_t p_green, int16_t p_blue)
+        {
+            const __m256i l_red_green = _mm256_set1_epi32(pair(p_red, p_green));
+            const __m256i l_blue = _mm256_set1_epi32(pair(p_blue, 0));
+            __m256i l_low = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(p_red_green_low, l_red_green), _mm256_madd_epi16(p_blue_low, l_blue)), m_yuv_shift);
+            __m256i l_high = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(p_red_green_high, l_red_green), _mm256_madd_epi16(p_blue_high, l_blue)), m_yuv_shift);
+            return _mm256_packs_epi32(l_low, l_high);
+        };
+        for(; l_index + 16 <= p_size; l_index += 16)
+        {
+            __m256i l_red = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p_reds + l_index)));
+            __m256i l_green = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p_greens + l_index)));
+            __m256i l_blue = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p_blues + l_index)));
+            __m256i l_red_green_low = _mm256_unpacklo_epi16(l_red, l_green);
+            __m256i l_red_green_high = _mm256_unpackhi_epi16(l_red, l_green);
+            __m256i l_blue_low = _mm256_unpacklo_epi16(l_blue, l_zero);
+            __m256i l_blue_high = _mm256_unpackhi_epi16(l_blue, l_zero);
+            _mm256_storeu_si256((__m256i*)(p_ys + l_index), l_convert(l_red_green_low, l_red_green_high, l_blue_low, l_blue_high, m_y_red, m_y_green, m_y_blue));
+            _mm256_storeu_si256((__m256i*)(p_us + l_index), l_convert(l_red_green_low, l_red_green_high, l_blue_low, l_blue_high, m_u_red, m_u_green, m_u_blue));
+            _mm256_storeu_si256((__m256i*)(p_vs + l_index), l_convert(l_red_green_low, l_red_green_high, l_blue_low, l_blue_high, m_v_red, m_v_green, m_v_blue));
+        }
+#elif defined(__SSE2__)
+        // Red and green are interleaved to be multiplied and summed by one
+        // madd instruction, blue being interleaved with zero
+        const __m128i l_zero = _mm_setzero_si128();
+        auto l_convert = [&](__m128i p_red_green_low, __m128i p_red_green_high, __m128i p_blue_low, __m128i p_blue_high, int16_t p_red, int16_t p_green, int16_t p_blue)
+        {
+            const __m128i l_red_green = _mm_set1_epi32(pair(p_red, p_green));
+            const __m128i l_blue = _mm_set1_epi32(pair(p_blue, 0));
+            __m128i l_low = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(p_red_green_low, l_red_green), _mm_madd_epi16(p_blue_low, l_blue)), m_yuv_shift);
+            __m128i l_high = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(p_red_green_high, l_red_green), _mm_madd_epi16(p_blue_high, l_blue)), m_yuv_shift);
+            return _mm_packs_epi32(l_low, l_high);
+        };
+        for(; l_index + 8 <= p_size; l_index += 8)
+        {
+            __m128i l_red = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(p_reds + l_index)), l_zero);
+            __m128i l_green = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(p_greens + l_index)), l_zero);
+            __m128i l_blue = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(p_blues + l_index)), l_zero);
+            __m128i l_red_green_low = _mm_unpacklo_epi16(l_red, l_green);
+            __m128i l_red_green_high = _mm_unpackhi_epi16(l_red, l_green);
+            __m128i l_blue_low = _mm_unpacklo_epi16(l_blue, l_zero);
+            __m128i l_blue_high = _mm_unpackhi_epi16(l_blue, l_zero);
+            _mm_storeu_si128((__m128i*)(p_ys + l_index), l_convert(l_red_green_low, l_red_green_high, l_blue_low, l_blue_high, m_y_red, m_y_green, m_y_blue));
+            _mm_storeu_si128((__m128i*)(p_us + l_index), l_convert(l_red_green_low, l_red_green_high, l_blue_low, l_blue_high, m_u_red, m_u_green, m_u_blue));
+            _mm_storeu_si128((__m128i*)(p_vs + l_index), l_convert(l_red_green_low, l_red_green_high, l_blue_low, l_blue_high, m_v_red, m_v_green, m_v_blue));
+        }
+#endif // __AVX2__
+        for(; l_index < p_size; ++l_index)
+        {
+            int32_t l_red = p_reds[l_index];
+            int32_t l_green = p_greens[l_index];
+            int32_t l_blue = p_blues[l_index];
+            p_ys[l_index] = (int16_t)((m_y_red * l_red + m_y_green * l_green + m_y_blue * l_blue) >> m_yuv_shift);
+            p_us[l_index] = (int16_t)((m_u_red * l_red + m_u_green * l_green + m_u_blue * l_blue) >> m_yuv_shift);
+            p_vs[l_index] = (int16_t)((m_v_red * l_red + m_v_green * l_green + m_v_blue * l_blue) >> m_yuv_shift);
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    void
+    yuv_kernels::to_rgb_fixed( const int16_t * p_ys
+                             , const int16_t * p_us
+                             , const int16_t * p_vs
+                             , uint8_t * p_reds
+                             , uint8_t * p_greens
+                             , uint8_t * p_blues
+                             , size_t p_size
+                             )
+    {
+        const int32_t l_rounding = 1 << (m_rgb_shift - 1);
+        size_t l_index = 0;
+#if defined(__AVX2__)
+        // Y is interleaved with U or V to be multiplied and summed by one
+        // madd instruction. Green needs a third term so V is interleaved
+        // with one to add rounding constant in the same way
+        const __m256i l_one = _mm256_set1_epi16(1);
+        const __m256i l_rounding_vector = _mm256_set1_epi32(l_rounding);
+        const __m256i l_red_coefficients = _mm256_set1_epi32(pair(m_one, m_red_v));
+        const __m256i l_green_coefficients = _mm256_set1_epi32(pair(m_one, m_green_u));
+        const __m256i l_green_v_coefficients = _mm256_set1_epi32(pair(m_green_v, (int16_t)l_rounding));
+        const __m256i l_blue_coefficients = _mm256_set1_epi32(pair(m_one, m_blue_u));
+        // Unpack and pack instructions work inside 128 bits lanes, order
+        // is restored by gathering low 64 bits of each lane
+        auto l_store = [](uint8_t * p_components, __m256i p_low, __m256i p_high)
+        {
+            __m256i l_words = _mm256_packs_epi32(_mm256_srai_epi32(p_low, m_rgb_shift), _mm256_srai_epi32(p_high, m_rgb_shift));
+            __m256i l_bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(l_words, l_words), 0x08);
+            _mm_storeu_si128((__m128i*)p_components, _mm256_castsi256_si128(l_bytes));
+        };
+        for(; l_index + 16 <= p_size; l_index += 16)
+        {
+            __m256i l_y = _mm256_loadu_si256((const __m256i*)(p_ys + l_index));
+            __m256i l_u = _mm256_loadu_si256((const __m256i*)(p_us + l_index));
+            __m256i l_v = _mm256_loadu_si256((const __m256i*)(p_vs + l_index));
+            __m256i l_y_u_low = _mm256_unpacklo_epi16(l_y, l_u);
+            __m256i l_y_u_high = _mm256_unpackhi_epi16(l_y, l_u);
+            __m256i l_y_v_low = _mm256_unpacklo_epi16(l_y, l_v);
+            __m256i l_y_v_high = _mm256_unpackhi_epi16(l_y, l_v);
+            __m256i l_v_one_low = _mm256_unpacklo_epi16(l_v, l_one);
+            __m256i l_v_one_high = _mm256_unpackhi_epi16(l_v, l_one);
+            l_store( p_reds + l_index
+                   , _mm256_add_epi32(_mm256_madd_epi16(l_y_v_low, l_red_coefficients), l_rounding_vector)
+                   , _mm256_add_epi32(_mm256_madd_epi16(l_y_v_high, l_red_coefficients), l_rounding_vector)
+                   );
+            l_store( p_greens + l_index
+                   , _mm256_add_epi32(_mm256_madd_epi16(l_y_u_low, l_green_coefficients), _mm256_madd_epi16(l_v_one_low, l_green_v_coefficients))
+                   , _mm256_add_epi32(_mm256_madd_epi16(l_y_u_high, l_green_coefficients), _mm256_madd_epi16(l_v_one_high, l_green_v_coefficients))
+                   );
+            l_store( p_blues + l_index
+                   , _mm256_add_epi32(_mm256_madd_epi16(l_y_u_low, l_blue_coefficients), l_rounding_vector)
+                   , _mm256_add_epi32(_mm256_madd_epi16(l_y_u_high, l_blue_coefficients), l_rounding_vector)
+                   );
+        }
+#elif defined(__SSE2__)
+        // Y is interleaved with U or V to be multiplied and summed by one
+        // madd instruction. Green needs a third term so V is interleaved
+        // with one to add rounding constant in the same way
+        const __m128i l_one = _mm_set1_epi16(1);
+        const __m128i l_rounding_vector = _mm_set1_epi32(l_rounding);
+        const __m128i l_red_coefficients = _mm_set1_epi32(pair(m_one, m_red_v));
+        const __m128i l_green_coefficients = _mm_set1_epi32(pair(m_one, m_green_u));
+        const __m128i l_green_v_coefficients = _mm_set1_epi32(pair(m_green_v, (int16_t)l_rounding));
+        const __m128i l_blue_coefficients = _mm_set1_epi32(pair(m_one, m_blue_u));
+        auto l_store = [](uint8_t * p_components, __m128i p_low, __m128i p_high)
+        {
+            __m128i l_words = _mm_packs_epi32(_mm_srai_epi32(p_low, m_rgb_shift), _mm_srai_epi32(p_high, m_rgb_shift));
+            _mm_storel_epi64((__m128i*)p_components, _mm_packus_epi16(l_words, l_words));
+        };
+        for(; l_index + 8 <= p_size; l_index += 8)
+        {
+            __m128i l_y = _mm_loadu_si128((const __m128i*)(p_ys + l_index));
+            __m128i l_u = _mm_loadu_si128((const __m128i*)(p_us + l_index));
+            __m128i l_v = _mm_loadu_si128((const __m128i*)(p_vs + l_index));
+            __m128i l_y_u_low = _mm_unpacklo_epi16(l_y, l_u);
+            __m128i l_y_u_high = _mm_unpackhi_epi16(l_y, l_u);
+            __m128i l_y_v_low = _mm_unpacklo_epi16(l_y, l_v);
+            __m128i l_y_v_high = _mm_unpackhi_epi16(l_y, l_v);
+            __m128i l_v_one_low = _mm_unpacklo_epi16(l_v, l_one);
+            __m128i l_v_one_high = _mm_unpackhi_epi16(l_v, l_one);
+            l_store( p_reds + l_index
+                   , _mm_add_epi32(_mm_madd_epi16(l_y_v_low, l_red_coefficients), l_rounding_vector)
+                   , _mm_add_epi32(_mm_madd_epi16(l_y_v_high, l_red_coefficients), l_rounding_vector)
+                   );
+            l_store( p_greens + l_index
+                   , _mm_add_epi32(_mm_madd_epi16(l_y_u_low, l_green_coefficients), _mm_madd_epi16(l_v_one_low, l_green_v_coefficients))
+                   , _mm_add_epi32(_mm_madd_epi16(l_y_u_high, l_green_coefficients), _mm_madd_epi16(l_v_one_high, l_green_v_coefficients))
+                   );
+            l_store( p_blues + l_index
+                   , _mm_add_epi32(_mm_madd_epi16(l_y_u_low, l_blue_coefficients), l_rounding_vector)
+                   , _mm_add_epi32(_mm_madd_epi16(l_y_u_high, l_blue_coefficients), l_rounding_vector)
+                   );
+        }
+#endif // __AVX2__
+        for(; l_index < p_size; ++l_index)
+        {
+            int32_t l_y = p_ys[l_index] * m_one;
+            int32_t l_u = p_us[l_index];
+            int32_t l_v = p_vs[l_index];
+            p_reds[l_index] = clamp((l_y + m_red_v * l_v + l_rounding) >> m_rgb_shift);
+            p_greens[l_index] = clamp((l_y + m_green_u * l_u + m_green_v * l_v + l_rounding) >> m_rgb_shift);
+            p_blues[l_index] = clamp((l_y + m_blue_u * l_u + l_rounding) >> m_rgb_shift);
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    uint8_t
+    yuv_kernels::clamp(long p_value)
+    {
+        return (uint8_t)std::min(255L, std::max(0L, p_value));
+    }
+
+    //-------------------------------------------------------------------------
+    int
+    yuv_kernels::pair( int16_t p_low
+                     , int16_t p_high
+                     )
+    {
+        return (int)(((uint32_t)(uint16_t)p_high << 16) | (uint16_t)p_low);
+    }
+
+}
+#endif //STEGANOGIF_YUV_KERNELS_H
+// EOF
@@ -19,11 +19,19 @@
 #include "password_input.h"
 #include "steganogif.h"
 #include "parameter_manager.h"
+#include <cctype>
 
 int main(int p_argc, char ** p_argv)
 {
     try
     {
+#ifdef STEGANOGIF_SELF_TEST
+        if(2 == p_argc && std::string("--self_test") == p_argv[1])
+        {
+            return steganogif::steganogif::self_test() ? 0 : -1;
+        }
+#endif // STEGANOGIF_SELF_TEST
+
         // Defining application command line parameters
         parameter_manager::parameter_manager l_param_manager("steganogif.exe","--",2);
         parameter_manager::parameter_if l_gif_file_name_parameter("gif", false);
@@ -34,6 +42,12 @@ int main(int p_argc, char ** p_argv)
         l_param_manager.add(l_bmp_file_name_parameter);
         parameter_manager::parameter_if l_password_parameter("password", true);
         l_param_manager.add(l_password_parameter);
+        parameter_manager::parameter_if l_dump_bmp_parameter("dump_bmp", true);
+        l_param_manager.add(l_dump_bmp_parameter);
+        parameter_manager::parameter_if l_range_parameter("range", true);
+        l_param_manager.add(l_range_parameter);
+        parameter_manager::parameter_if l_quantizer_parameter("quantizer", true);
+        l_param_manager.add(l_quantizer_parameter);
 
         // Treating parameters
         l_param_manager.treat_parameters(p_argc, p_argv);
@@ -46,19 +60,97 @@ int main(int p_argc, char ** p_argv)
             std::cout << R"(You enter password ")" << l_password << R"(")" << std::endl;
         }
 
-        steganogif::steganogif l_steganogif{l_password};
+        // Debug mode dumping each frame as BMP file
+        bool l_dump_bmp = false;
+        auto l_dump_bmp_value = l_dump_bmp_parameter.get_value<std::string>();
+        if("1" == l_dump_bmp_value || "true" == l_dump_bmp_value)
+        {
+            l_dump_bmp = true;
+        }
+        else if(!l_dump_bmp_value.empty() && "0" != l_dump_bmp_value && "false" != l_dump_bmp_value)
+        {
+            throw quicky_exception::quicky_logic_exception(R"(Bad dump_bmp value ")" + l_dump_bmp_value + R"(", expected 1, true, 0 or false)", __LINE__, __FILE__);
+        }
+
+        steganogif::steganogif l_steganogif{l_password, l_dump_bmp};
 
         auto l_gif_file_name = l_gif_file_name_parameter.get_value<std::string>();
         auto l_bmp_file_name = l_bmp_file_name_parameter.get_value<std::string>();
         auto l_content_file_name = l_content_file_name_parameter.get_value<std::string>();
 
+        // Byte range to extract expressed as <start>:<end>, end being
+        // excluded and optional
+        uint64_t l_range_start = 0;
+        uint64_t l_range_end = std::numeric_limits<uint64_t>::max();
+        auto l_range = l_range_parameter.get_value<std::string>();
+        if(!l_range.empty())
+        {
+            size_t l_separator = l_range.find(':');
+            // std::stoull accepts leading spaces and signs, negative values
+            // being wrapped, and ignores trailing characters so bounds are
+            // required to be made of digits only
+            auto l_parse_bound = [](const std::string & p_bound)
+            {
+                if(p_bound.empty() || !std::isdigit((unsigned char)p_bound[0]))
+                {
+                    throw std::invalid_argument("bound should start with a digit");
+                }
+                size_t l_nb_parsed = 0;
+                uint64_t l_value = std::stoull(p_bound, &l_nb_parsed);
+                if(l_nb_parsed != p_bound.size())
+                {
+                    throw std::invalid_argument("unexpected characters after bound");
+                }
+                return l_value;
+            };
+            try
+            {
+                if(std::string::npos == l_separator)
+                {
+                    throw std::invalid_argument("missing separator");
+                }
+                l_range_start = l_parse_bound(l_range.substr(0, l_separator));
+                if(l_separator + 1 < l_range.size())
+                {
+                    l_range_end = l_parse_bound(l_range.substr(l_separator + 1));
+                }
+            }
+            catch(std::logic_error & e)
+            {
+                throw quicky_exception::quicky_logic_exception(R"(Bad range ")" + l_range + R"(", expected <start>:<end> with non negative integer bounds)", __LINE__, __FILE__);
+            }
+            if(!l_bmp_file_name.empty())
+            {
+                throw quicky_exception::quicky_logic_exception("Byte range is only supported when decoding", __LINE__, __FILE__);
+            }
+        }
+
+        // Color reduction algorithm : grid (default) or median_cut
+        steganogif::steganogif::quantizer_type l_quantizer = steganogif::steganogif::quantizer_type::grid;
+        auto l_quantizer_name = l_quantizer_parameter.get_value<std::string>();
+        if(!l_quantizer_name.empty())
+        {
+            if("median_cut" == l_quantizer_name)
+            {
+                l_quantizer = steganogif::steganogif::quantizer_type::median_cut;
+            }
+            else if("grid" != l_quantizer_name)
+            {
+                throw quicky_exception::quicky_logic_exception(R"(Unknown quantizer ")" + l_quantizer_name + R"(", expected grid or median_cut)", __LINE__, __FILE__);
+            }
+            if(l_bmp_file_name.empty())
+            {
+                throw quicky_exception::quicky_logic_exception("Quantizer is only used when encoding", __LINE__, __FILE__);
+            }
+        }
+
         if(l_bmp_file_name.empty())
         {
-            l_steganogif.decode(l_gif_file_name, l_content_file_name);
+            l_steganogif.decode(l_gif_file_name, l_content_file_name, l_range_start, l_range_end);
         }
         else
         {
-            l_steganogif.encode(l_gif_file_name, l_content_file_name, l_bmp_file_name);
+            l_steganogif.encode(l_gif_file_name, l_content_file_name, l_bmp_file_name, l_quantizer);
         }
 
     }